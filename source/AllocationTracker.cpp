@@ -0,0 +1,144 @@
+#include "pch.h"
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace dae
+{
+	namespace AllocationTracker
+	{
+#ifdef TRACK_ALLOCATIONS
+		static std::atomic<uint64_t> s_AllocationCount{ 0 };
+
+		bool IsEnabled()
+		{
+			return true;
+		}
+
+		uint64_t GetAllocationCount()
+		{
+			return s_AllocationCount.load(std::memory_order_relaxed);
+		}
+
+		static void* Allocate(size_t size)
+		{
+			s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+			return std::malloc(size == 0 ? 1 : size);
+		}
+
+		static void* AllocateAligned(size_t size, std::align_val_t alignment)
+		{
+			s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+#ifdef _MSC_VER
+			return _aligned_malloc(size == 0 ? 1 : size, static_cast<size_t>(alignment));
+#else
+			const size_t alignedSize{ (std::max(size, size_t{ 1 }) + static_cast<size_t>(alignment) - 1) & ~(static_cast<size_t>(alignment) - 1) };
+			return std::aligned_alloc(static_cast<size_t>(alignment), alignedSize);
+#endif
+		}
+
+		static void FreeAligned(void* pMemory)
+		{
+#ifdef _MSC_VER
+			_aligned_free(pMemory);
+#else
+			std::free(pMemory);
+#endif
+		}
+#else
+		bool IsEnabled()
+		{
+			return false;
+		}
+
+		uint64_t GetAllocationCount()
+		{
+			return 0;
+		}
+#endif
+	}
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+//Replacements of the global allocation functions, every form forwards to the counting allocators above
+void* operator new(size_t size)
+{
+	void* pMemory{ dae::AllocationTracker::Allocate(size) };
+	if (!pMemory) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new[](size_t size)
+{
+	void* pMemory{ dae::AllocationTracker::Allocate(size) };
+	if (!pMemory) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return dae::AllocationTracker::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return dae::AllocationTracker::Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* pMemory{ dae::AllocationTracker::AllocateAligned(size, alignment) };
+	if (!pMemory) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* pMemory{ dae::AllocationTracker::AllocateAligned(size, alignment) };
+	if (!pMemory) throw std::bad_alloc{};
+	return pMemory;
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+	dae::AllocationTracker::FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, std::align_val_t) noexcept
+{
+	dae::AllocationTracker::FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept
+{
+	dae::AllocationTracker::FreeAligned(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept
+{
+	dae::AllocationTracker::FreeAligned(pMemory);
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Counts every call to the global operator new, so a frame can be checked for heap allocations
+	//The global allocation functions are only replaced when TRACK_ALLOCATIONS is defined, as in the Benchmark configuration, other builds keep the CRT (debug) heap
+	namespace AllocationTracker
+	{
+		bool IsEnabled();
+		uint64_t GetAllocationCount();
+	}
+}
@@ -63,8 +63,8 @@ namespace dae
 				Vector4{origin, 1}
 			};
 			//Inverse(ONB) => ViewMatrix
-
-			viewMatrix = Matrix::Inverse(invViewMatrix);
+			//The ONB is a rotation and a translation, so its inverse is the transposed rotation and the translation rotated back
+			viewMatrix = Matrix::InverseOrthonormal(invViewMatrix);
 
 			//ViewMatrix => Matrix::CreateLookAtLH(...) [not implemented yet]
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
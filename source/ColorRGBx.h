@@ -0,0 +1,96 @@
+#pragma once
+#include "Floatx.h"
+#include "ColorRGB.h"
+
+namespace dae
+{
+	//N ColorRGBs as a structure of arrays, see Floatx
+	template<int N>
+	struct ColorRGBx
+	{
+		Floatx<N> r{};
+		Floatx<N> g{};
+		Floatx<N> b{};
+
+		static ColorRGBx Broadcast(const ColorRGB& c)
+		{
+			return { Floatx<N>::Broadcast(c.r), Floatx<N>::Broadcast(c.g), Floatx<N>::Broadcast(c.b) };
+		}
+
+		ColorRGB GetLane(int lane) const
+		{
+			return { r.lanes[lane], g.lanes[lane], b.lanes[lane] };
+		}
+
+		void SetLane(int lane, const ColorRGB& c)
+		{
+			r.lanes[lane] = c.r;
+			g.lanes[lane] = c.g;
+			b.lanes[lane] = c.b;
+		}
+
+		void MaxToOne()
+		{
+			for (int i{}; i < N; ++i)
+			{
+				const float maxValue = std::max(r.lanes[i], std::max(g.lanes[i], b.lanes[i]));
+				if (maxValue > 1.f)
+				{
+					r.lanes[i] /= maxValue;
+					g.lanes[i] /= maxValue;
+					b.lanes[i] /= maxValue;
+				}
+			}
+		}
+
+		static ColorRGBx Lerp(const ColorRGBx& c1, const ColorRGBx& c2, const Floatx<N>& factor)
+		{
+			return { dae::Lerp(c1.r, c2.r, factor), dae::Lerp(c1.g, c2.g, factor), dae::Lerp(c1.b, c2.b, factor) };
+		}
+
+		#pragma region ColorRGBx (Member) Operators
+		ColorRGBx operator+(const ColorRGBx& c) const
+		{
+			return { r + c.r, g + c.g, b + c.b };
+		}
+
+		ColorRGBx operator+(const ColorRGB& c) const
+		{
+			return { r + Floatx<N>::Broadcast(c.r), g + Floatx<N>::Broadcast(c.g), b + Floatx<N>::Broadcast(c.b) };
+		}
+
+		ColorRGBx operator*(const ColorRGBx& c) const
+		{
+			return { r * c.r, g * c.g, b * c.b };
+		}
+
+		ColorRGBx operator*(const Floatx<N>& s) const
+		{
+			return { r * s, g * s, b * s };
+		}
+
+		ColorRGBx operator*(float s) const
+		{
+			return { r * s, g * s, b * s };
+		}
+
+		ColorRGBx operator/(float s) const
+		{
+			return { r / s, g / s, b / s };
+		}
+		#pragma endregion
+	};
+
+	//Global Operators
+	template<int N>
+	inline ColorRGBx<N> operator*(float s, const ColorRGBx<N>& c)
+	{
+		return c * s;
+	}
+
+	template<int N>
+	inline ColorRGBx<N> Select(uint32_t laneMask, const ColorRGBx<N>& c1, const ColorRGBx<N>& c2)
+	{
+		return { Select(laneMask, c1.r, c2.r), Select(laneMask, c1.g, c2.g), Select(laneMask, c1.b, c2.b) };
+	}
+}
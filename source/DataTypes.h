@@ -23,9 +23,42 @@ namespace dae
 		Vector2 uv{};
 		Vector3 normal{};
 		Vector3 tangent{};
+		Vector3 binormal{};
 		Vector3 viewDirection{};
 	};
 
+	//Post-transform vertex of the software rasterizer, computed once per vertex
+	//The raster data is only filled in when the vertex doesn't need clipping
+	struct Vertex_Raster
+	{
+		int32_t fixedX{}; //28.4 fixed point raster position
+		int32_t fixedY{};
+		float z{}; //NDC depth
+		float invW{};
+		uint32_t outcode{}; //clip planes the vertex lies outside of
+	};
+
+	//Structure of arrays copy of a mesh's vertices for the software rasterizer
+	//One stream per component, so one SIMD load reads the same component of consecutive vertices
+	struct VertexStreams
+	{
+		std::vector<float> positionX{};
+		std::vector<float> positionY{};
+		std::vector<float> positionZ{};
+		std::vector<float> u{};
+		std::vector<float> v{};
+		std::vector<float> normalX{};
+		std::vector<float> normalY{};
+		std::vector<float> normalZ{};
+		std::vector<float> tangentX{};
+		std::vector<float> tangentY{};
+		std::vector<float> tangentZ{};
+		//Cross(normal, tangent), computed once when the mesh is created so shading in object space doesn't redo it per pixel
+		std::vector<float> binormalX{};
+		std::vector<float> binormalY{};
+		std::vector<float> binormalZ{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
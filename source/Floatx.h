@@ -0,0 +1,218 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "MathHelpers.h"
+
+namespace dae
+{
+	//N floats that are operated on together, one lane per pixel
+	//Every operation is a plain loop over the lanes, the compiler turns those into SIMD instructions
+	//and every lane rounds exactly like the scalar operation would
+	//Lane masks are uint32_t with one bit per lane, like the masks of the raster kernels
+	template<int N>
+	struct Floatx
+	{
+		static_assert(N > 0 && N <= 32, "A lane mask holds at most 32 lanes");
+
+		float lanes[N]{};
+
+		static Floatx Broadcast(float value)
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = value;
+			return result;
+		}
+
+		static Floatx Load(const float* pValues)
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = pValues[i];
+			return result;
+		}
+
+		static constexpr uint32_t FullMask() { return N == 32 ? ~0u : (1u << N) - 1; }
+
+		float& operator[](int lane) { return lanes[lane]; }
+		float operator[](int lane) const { return lanes[lane]; }
+
+		#pragma region Floatx (Member) Operators
+		Floatx operator+(const Floatx& f) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] + f.lanes[i];
+			return result;
+		}
+
+		Floatx operator-(const Floatx& f) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] - f.lanes[i];
+			return result;
+		}
+
+		Floatx operator*(const Floatx& f) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] * f.lanes[i];
+			return result;
+		}
+
+		Floatx operator/(const Floatx& f) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] / f.lanes[i];
+			return result;
+		}
+
+		Floatx operator+(float s) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] + s;
+			return result;
+		}
+
+		Floatx operator-(float s) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] - s;
+			return result;
+		}
+
+		Floatx operator*(float s) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] * s;
+			return result;
+		}
+
+		Floatx operator/(float s) const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = lanes[i] / s;
+			return result;
+		}
+
+		Floatx operator-() const
+		{
+			Floatx result;
+			for (int i{}; i < N; ++i) result.lanes[i] = -lanes[i];
+			return result;
+		}
+		#pragma endregion
+	};
+
+	//Global Operators
+	template<int N>
+	inline Floatx<N> operator*(float s, const Floatx<N>& f)
+	{
+		return f * s;
+	}
+
+	template<int N>
+	inline Floatx<N> operator+(float s, const Floatx<N>& f)
+	{
+		return Floatx<N>::Broadcast(s) + f;
+	}
+
+	template<int N>
+	inline Floatx<N> operator-(float s, const Floatx<N>& f)
+	{
+		return Floatx<N>::Broadcast(s) - f;
+	}
+
+	template<int N>
+	inline Floatx<N> Sqrt(const Floatx<N>& f)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = sqrtf(f.lanes[i]);
+		return result;
+	}
+
+	//No vector form, every lane calls powf
+	template<int N>
+	inline Floatx<N> Pow(const Floatx<N>& base, const Floatx<N>& exponent)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = powf(base.lanes[i], exponent.lanes[i]);
+		return result;
+	}
+
+	template<int N>
+	inline Floatx<N> Max(const Floatx<N>& f1, const Floatx<N>& f2)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = std::max(f1.lanes[i], f2.lanes[i]);
+		return result;
+	}
+
+	template<int N>
+	inline Floatx<N> Min(const Floatx<N>& f1, const Floatx<N>& f2)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = std::min(f1.lanes[i], f2.lanes[i]);
+		return result;
+	}
+
+	//Same steps and results as FastPowf, one loop per step since a clamp followed by more math in the same loop isn't vectorized
+	template<int N>
+	inline Floatx<N> FastPow(const Floatx<N>& base, const Floatx<N>& exponent)
+	{
+		Floatx<N> log2Base;
+		for (int i{}; i < N; ++i) log2Base.lanes[i] = FastLog2f(base.lanes[i]);
+		for (int i{}; i < N; ++i) log2Base.lanes[i] = base.lanes[i] < FLT_MIN ? -FLT_MAX : log2Base.lanes[i];
+
+		const Floatx<N> biased{ Min(Max(exponent * log2Base + 127.f, Floatx<N>::Broadcast(63.f)), Floatx<N>::Broadcast(254.f)) };
+
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = FastExp2Biasedf(biased.lanes[i]);
+		for (int i{}; i < N; ++i) result.lanes[i] = biased.lanes[i] > 63.f ? result.lanes[i] : 0.f;
+		return result;
+	}
+
+	//FastRSqrtf on every lane, the estimates 4 lanes at a time since an intrinsic in a plain loop isn't vectorized
+	template<int N>
+	inline Floatx<N> FastRSqrt(const Floatx<N>& f)
+	{
+		Floatx<N> estimate;
+		int i{};
+		for (; i + 4 <= N; i += 4) _mm_storeu_ps(estimate.lanes + i, _mm_rsqrt_ps(_mm_loadu_ps(f.lanes + i)));
+		for (; i < N; ++i) estimate.lanes[i] = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(f.lanes[i])));
+
+		return estimate * (1.5f - .5f * f * estimate * estimate);
+	}
+
+	template<int N>
+	inline Floatx<N> Saturate(const Floatx<N>& f)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = Saturate(f.lanes[i]);
+		return result;
+	}
+
+	template<int N>
+	inline Floatx<N> Lerp(const Floatx<N>& f1, const Floatx<N>& f2, const Floatx<N>& factor)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = Lerpf(f1.lanes[i], f2.lanes[i], factor.lanes[i]);
+		return result;
+	}
+
+	//Lanes set in laneMask come from f1, the others from f2
+	template<int N>
+	inline Floatx<N> Select(uint32_t laneMask, const Floatx<N>& f1, const Floatx<N>& f2)
+	{
+		Floatx<N> result;
+		for (int i{}; i < N; ++i) result.lanes[i] = (laneMask >> i) & 1 ? f1.lanes[i] : f2.lanes[i];
+		return result;
+	}
+
+	//One bit per lane where f1 < f2
+	template<int N>
+	inline uint32_t LessThan(const Floatx<N>& f1, const Floatx<N>& f2)
+	{
+		uint32_t laneMask{};
+		for (int i{}; i < N; ++i) laneMask |= static_cast<uint32_t>(f1.lanes[i] < f2.lanes[i]) << i;
+		return laneMask;
+	}
+}
@@ -4,4 +4,8 @@
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Matrix.h"
-#include "MathHelpers.h"
\ No newline at end of file
+#include "MathHelpers.h"
+#include "Floatx.h"
+#include "Vector2x.h"
+#include "Vector3x.h"
+#include "ColorRGBx.h"
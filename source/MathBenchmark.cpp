@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "MathBenchmark.h"
+#include <cfloat>
+#include <cstring>
+#include <random>
+#include <span>
+
+namespace dae
+{
+	namespace MathBenchmark
+	{
+		namespace
+		{
+			//Runs the operation over all elements a few times and reports the fastest run
+			//The results are stored and summed afterwards, so nothing can be optimized away
+			template<typename Result, typename Operation>
+			void TimeOperation(const char* name, std::vector<Result>& results, int numRepeats, float& checksum, Operation operation)
+			{
+				const float nanosecondsPerCount{ 1'000'000'000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+				const int numElements{ static_cast<int>(results.size()) };
+
+				float bestTime{ FLT_MAX };
+				for (int repeat{}; repeat < numRepeats; ++repeat)
+				{
+					const uint64_t startTime{ SDL_GetPerformanceCounter() };
+					for (int i{}; i < numElements; ++i)
+					{
+						results[i] = operation(i);
+					}
+					const float time{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numElements) };
+					bestTime = std::min(bestTime, time);
+				}
+
+				for (const Result& result : results)
+				{
+					float firstComponent{};
+					std::memcpy(&firstComponent, &result, sizeof(float));
+					checksum += firstComponent;
+				}
+
+				std::cout << ">> " << name << " = " << bestTime << " ns" << std::endl;
+			}
+
+			//Same as above for the span overloads, the whole array goes through one call
+			template<typename Result, typename Operation>
+			void TimeBatch(const char* name, std::vector<Result>& results, int numRepeats, float& checksum, Operation operation)
+			{
+				const float nanosecondsPerCount{ 1'000'000'000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+				const int numElements{ static_cast<int>(results.size()) };
+
+				float bestTime{ FLT_MAX };
+				for (int repeat{}; repeat < numRepeats; ++repeat)
+				{
+					const uint64_t startTime{ SDL_GetPerformanceCounter() };
+					operation(std::span<Result>{ results });
+					const float time{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numElements) };
+					bestTime = std::min(bestTime, time);
+				}
+
+				for (const Result& result : results)
+				{
+					float firstComponent{};
+					std::memcpy(&firstComponent, &result, sizeof(float));
+					checksum += firstComponent;
+				}
+
+				std::cout << ">> " << name << " = " << bestTime << " ns" << std::endl;
+			}
+		}
+
+		void Run(int numElements, int numRepeats)
+		{
+			std::mt19937 randomEngine{ 1234 };
+			std::uniform_real_distribution<float> randomValue{ -1.f, 1.f };
+			const auto randomVector = [&]() { return Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) }; };
+
+			std::vector<Vector3> vectorsA(numElements);
+			std::vector<Vector3> vectorsB(numElements);
+			std::vector<Vector4> points(numElements);
+			std::vector<Matrix> matrices(numElements);
+			for (int i{}; i < numElements; ++i)
+			{
+				vectorsA[i] = randomVector();
+				vectorsB[i] = randomVector();
+				points[i] = Vector4{ randomVector(), 1.f };
+				matrices[i] = Matrix::CreateRotation(randomVector() * PI) * Matrix::CreateTranslation(randomVector() * 100.f);
+			}
+
+			std::vector<float> floatResults(numElements);
+			std::vector<Vector3> vectorResults(numElements);
+			std::vector<Vector4> pointResults(numElements);
+			std::vector<Matrix> matrixResults(numElements);
+			float checksum{};
+
+			std::cout << "**MATH BENCHMARK** " << numElements << " operations, fastest of " << numRepeats << " runs\n";
+			TimeOperation("VECTOR3 ADD", vectorResults, numRepeats, checksum, [&](int i) { return vectorsA[i] + vectorsB[i]; });
+			TimeOperation("VECTOR3 DOT", floatResults, numRepeats, checksum, [&](int i) { return Vector3::Dot(vectorsA[i], vectorsB[i]); });
+			TimeOperation("VECTOR3 CROSS", vectorResults, numRepeats, checksum, [&](int i) { return Vector3::Cross(vectorsA[i], vectorsB[i]); });
+			TimeOperation("VECTOR3 NORMALIZED", vectorResults, numRepeats, checksum, [&](int i) { return vectorsA[i].Normalized(); });
+			TimeOperation("VECTOR3 REFLECT", vectorResults, numRepeats, checksum, [&](int i) { return Vector3::Reflect(vectorsA[i], vectorsB[i]); });
+			TimeOperation("MATRIX TRANSFORM VECTOR", vectorResults, numRepeats, checksum, [&](int i) { return matrices[i].TransformVector(vectorsA[i]); });
+			TimeOperation("MATRIX TRANSFORM POINT4", pointResults, numRepeats, checksum, [&](int i) { return matrices[i].TransformPoint(points[i]); });
+			TimeOperation("MATRIX TRANSFORM POINT", vectorResults, numRepeats, checksum, [&](int i) { return matrices[0].TransformPoint(vectorsA[i]); });
+			TimeBatch("MATRIX TRANSFORM POINTS (SPAN)", vectorResults, numRepeats, checksum, [&](std::span<Vector3> out) { matrices[0].TransformPoints(vectorsA, out); });
+			TimeOperation("MATRIX TRANSFORM VECTOR (ONE MATRIX)", vectorResults, numRepeats, checksum, [&](int i) { return matrices[0].TransformVector(vectorsA[i]); });
+			TimeBatch("MATRIX TRANSFORM VECTORS (SPAN)", vectorResults, numRepeats, checksum, [&](std::span<Vector3> out) { matrices[0].TransformVectors(vectorsA, out); });
+			TimeOperation("MATRIX TRANSFORM POINT4 (ONE MATRIX)", pointResults, numRepeats, checksum, [&](int i) { return matrices[0].TransformPoint(points[i]); });
+			TimeBatch("MATRIX TRANSFORM POINT4S (SPAN)", pointResults, numRepeats, checksum, [&](std::span<Vector4> out) { matrices[0].TransformPoints(points, out); });
+			TimeOperation("MATRIX MULTIPLY", matrixResults, numRepeats, checksum, [&](int i) { return matrices[i] * matrices[numElements - 1 - i]; });
+			TimeOperation("MATRIX INVERSE", matrixResults, numRepeats, checksum, [&](int i) { return Matrix::Inverse(matrices[i]); });
+			TimeOperation("MATRIX INVERSE AFFINE", matrixResults, numRepeats, checksum, [&](int i) { return Matrix::InverseAffine(matrices[i]); });
+			TimeOperation("MATRIX INVERSE ORTHONORMAL", matrixResults, numRepeats, checksum, [&](int i) { return Matrix::InverseOrthonormal(matrices[i]); });
+			std::cout << ">> CHECKSUM = " << checksum << std::endl;
+		}
+	}
+}
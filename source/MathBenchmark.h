@@ -0,0 +1,10 @@
+#pragma once
+
+namespace dae
+{
+	//Times the operations of the math types the renderer uses most and prints the cost per operation
+	namespace MathBenchmark
+	{
+		void Run(int numElements, int numRepeats);
+	}
+}
@@ -1,5 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <bit>
+#include <cfloat>
 #include <cmath>
+#include <cstdint>
+#include <xmmintrin.h>
 
 namespace dae
 {
@@ -21,45 +26,90 @@ namespace dae
 	constexpr auto TO_RADIANS(PI / 180.0f);
 
 	/* --- HELPER FUNCTIONS --- */
-	inline float Square(float a)
+	constexpr float Square(float a)
 	{
 		return a * a;
 	}
 
-	inline float Lerpf(float a, float b, float factor)
+	constexpr float Lerpf(float a, float b, float factor)
 	{
 		return ((1 - factor) * a) + (factor * b);
 	}
 
-	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
+	constexpr bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
-		return abs(a - b) < epsilon;
+		//std::abs isn't constexpr yet
+		const float difference{ a - b };
+		return (difference < 0.f ? -difference : difference) < epsilon;
 	}
 
-	inline int Clamp(const int v, int min, int max)
+	constexpr int Clamp(const int v, int min, int max)
 	{
 		if (v < min) return min;
 		if (v > max) return max;
 		return v;
 	}
 
-	inline float Clamp(const float v, float min, float max)
+	constexpr float Clamp(const float v, float min, float max)
 	{
 		if (v < min) return min;
 		if (v > max) return max;
 		return v;
 	}
 
-	inline float Saturate(const float v)
+	constexpr float Saturate(const float v)
 	{
 		if (v < 0.f) return 0.f;
 		if (v > 1.f) return 1.f;
 		return v;
 	}
 
-	inline float Remap(float original, float min = 0.995f, float max = 1.f)
+	constexpr float Remap(float original, float min = 0.995f, float max = 1.f)
 	{
 		const float clamped{ Clamp(original, min, max) };
 		return (clamped - min) / (max - min);
 	}
-}
\ No newline at end of file
+
+	//log2 of a normal x > 0 from the exponent bits and a polynomial for the mantissa, off by at most 1.82e-5, exact for powers of 2
+	constexpr float FastLog2f(float x)
+	{
+		const uint32_t bits{ std::bit_cast<uint32_t>(x) };
+		const float exponent{ static_cast<float>(static_cast<int>(bits >> 23) - 127) };
+		const float t{ std::bit_cast<float>((bits & 0x007FFFFF) | 0x3F800000) - 1.f }; //0 to 1
+		return exponent + t * (1.44196557f + t * (-0.70966237f + t * (0.41759442f + t * (-0.19626801f + t * 0.04638469f))));
+	}
+
+	//2^(biased - 127) for biased in [1, 254], the whole part is the exponent bits and a polynomial for the fraction is added to them
+	constexpr float FastExp2Biasedf(float biased)
+	{
+		const int whole{ static_cast<int>(biased) }; //positive, so truncating is a floor
+		const float f{ biased - static_cast<float>(whole) }; //0 to 1
+		const float fraction{ 1.f + f * (0.69301853f + f * (0.24144551f + f * (0.05195054f + f * 0.01358125f))) }; //1 to 2
+		return std::bit_cast<float>(std::bit_cast<uint32_t>(fraction) + (static_cast<uint32_t>(whole - 127) << 23));
+	}
+
+	//2^y, relative error at most 1e-5
+	//Results below 2^-64 are flushed to 0, multiplying by anything that small could make denormals, which are very slow
+	constexpr float FastExp2f(float y)
+	{
+		const float biased{ std::min(std::max(y + 127.f, 63.f), 254.f) };
+		return biased > 63.f ? FastExp2Biasedf(biased) : 0.f;
+	}
+
+	//base^exponent for base >= 0 as 2^(exponent * log2(base))
+	//The relative error grows with the exponent, about 1e-5 * |exponent| + 1e-5, far below a colour step for Phong exponents
+	//Bases below the smallest normal float count as 0 and give 0, or 1 for an exponent of 0 like powf, results below 2^-64 are 0
+	constexpr float FastPowf(float base, float exponent)
+	{
+		const float log2Base{ base < FLT_MIN ? -FLT_MAX : FastLog2f(base) };
+		return FastExp2f(exponent * log2Base);
+	}
+
+	//1 / sqrt(x) for x > 0, the 12 bit estimate of rsqrtss refined with one Newton-Raphson step, relative error below 3e-7
+	//The estimate differs between CPU vendors, so unlike the other helpers the last bit isn't the same on every machine
+	inline float FastRSqrtf(float x)
+	{
+		const float estimate{ _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x))) };
+		return estimate * (1.5f - .5f * x * estimate * estimate);
+	}
+}
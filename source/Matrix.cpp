@@ -1,290 +1,194 @@
 #include "pch.h"
-
 #include "Matrix.h"
 
-#include <cassert>
-
-#include "MathHelpers.h"
-#include <cmath>
+#include <immintrin.h>
 
-namespace dae {
-	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
-		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+namespace dae
+{
+	namespace
 	{
-	}
+		//Checked once, every batch transform picks its path from it
+		bool HasAVX()
+		{
+			static const bool hasAVX{ SDL_HasAVX() == SDL_TRUE };
+			return hasAVX;
+		}
 
-	Matrix::Matrix(const Vector4& xAxis, const Vector4& yAxis, const Vector4& zAxis, const Vector4& t)
-	{
-		data[0] = xAxis;
-		data[1] = yAxis;
-		data[2] = zAxis;
-		data[3] = t;
-	}
+		//4 Vector3s in 3 registers: x0y0z0x1 y1z1x2y2 z2x3y3z3 to xxxx yyyy zzzz and back
+		//The shuffles stay within 128 bit lanes, so the AVX versions do the same for 2 groups of 4 at once
+		void ToLanesSSE(__m128 a, __m128 b, __m128 c, __m128& x, __m128& y, __m128& z)
+		{
+			const __m128 xy{ _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)) };	//x2 y2 x3 y3
+			const __m128 yz{ _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)) };	//y0 z0 y1 z1
+			x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+		}
 
-	Matrix::Matrix(const Matrix& m)
-	{
-		data[0] = m[0];
-		data[1] = m[1];
-		data[2] = m[2];
-		data[3] = m[3];
-	}
+		void FromLanesSSE(__m128 x, __m128 y, __m128 z, __m128& a, __m128& b, __m128& c)
+		{
+			const __m128 xy02{ _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0)) };	//x0 x2 y0 y2
+			const __m128 zx{ _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0)) };		//z0 z2 x1 x3
+			const __m128 yz13{ _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1)) };	//y1 y3 z1 z3
+			a = _mm_shuffle_ps(xy02, zx, _MM_SHUFFLE(2, 0, 2, 0));
+			b = _mm_shuffle_ps(yz13, xy02, _MM_SHUFFLE(3, 1, 2, 0));
+			c = _mm_shuffle_ps(zx, yz13, _MM_SHUFFLE(3, 1, 3, 1));
+		}
 
-	Vector3 Matrix::TransformVector(const Vector3& v) const
-	{
-		return TransformVector(v.x, v.y, v.z);
-	}
+		void ToLanesAVX(__m256 a, __m256 b, __m256 c, __m256& x, __m256& y, __m256& z)
+		{
+			const __m256 xy{ _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)) };
+			const __m256 yz{ _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)) };
+			x = _mm256_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm256_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+		}
 
-	Vector3 Matrix::TransformVector(float x, float y, float z) const
-	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z,
-			data[0].y * x + data[1].y * y + data[2].y * z,
-			data[0].z * x + data[1].z * y + data[2].z * z
-		};
-	}
+		void FromLanesAVX(__m256 x, __m256 y, __m256 z, __m256& a, __m256& b, __m256& c)
+		{
+			const __m256 xy02{ _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0)) };
+			const __m256 zx{ _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0)) };
+			const __m256 yz13{ _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1)) };
+			a = _mm256_shuffle_ps(xy02, zx, _MM_SHUFFLE(2, 0, 2, 0));
+			b = _mm256_shuffle_ps(yz13, xy02, _MM_SHUFFLE(3, 1, 2, 0));
+			c = _mm256_shuffle_ps(zx, yz13, _MM_SHUFFLE(3, 1, 3, 1));
+		}
 
-	Vector3 Matrix::TransformPoint(const Vector3& p) const
-	{
-		return TransformPoint(p.x, p.y, p.z);
-	}
+		//Vector3s as points or as vectors, 8 per iteration with AVX and 4 with SSE, the rest one by one
+		//Every lane does m[0][i] * x + m[1][i] * y + m[2][i] * z (+ m[3][i]), the same sum in the same order as TransformPoint / TransformVector
+		template<bool IsPoint>
+		void TransformVector3s(const Matrix& m, std::span<const Vector3> in, std::span<Vector3> out)
+		{
+			assert(out.size() >= in.size() && "ERROR: the output of a batch transform is smaller than its input");
+			const int count{ static_cast<int>(in.size()) };
+			const float* pIn{ &in.data()->x };
+			float* pOut{ &out.data()->x };
 
-	Vector3 Matrix::TransformPoint(float x, float y, float z) const
-	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-		};
-	}
+			int i{ 0 };
+			if (HasAVX())
+			{
+				__m256 rows[4][3]{};
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					for (int c{ 0 }; c < 3; ++c)
+					{
+						rows[r][c] = _mm256_set1_ps(m[r][c]);
+					}
+				}
+
+				for (; i + 8 <= count; i += 8)
+				{
+					//The low halves hold vectors i to i + 3, the high halves i + 4 to i + 7
+					const float* pSource{ pIn + i * 3 };
+					const __m256 a{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pSource)), _mm_loadu_ps(pSource + 12), 1) };
+					const __m256 b{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pSource + 4)), _mm_loadu_ps(pSource + 16), 1) };
+					const __m256 c{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pSource + 8)), _mm_loadu_ps(pSource + 20), 1) };
+					__m256 x, y, z;
+					ToLanesAVX(a, b, c, x, y, z);
+
+					__m256 result[3];
+					for (int column{ 0 }; column < 3; ++column)
+					{
+						const __m256 xy{ _mm256_add_ps(_mm256_mul_ps(rows[0][column], x), _mm256_mul_ps(rows[1][column], y)) };
+						result[column] = _mm256_add_ps(xy, _mm256_mul_ps(rows[2][column], z));
+						if constexpr (IsPoint) result[column] = _mm256_add_ps(result[column], rows[3][column]);
+					}
+
+					__m256 outA, outB, outC;
+					FromLanesAVX(result[0], result[1], result[2], outA, outB, outC);
+					float* pTarget{ pOut + i * 3 };
+					_mm_storeu_ps(pTarget, _mm256_castps256_ps128(outA));
+					_mm_storeu_ps(pTarget + 4, _mm256_castps256_ps128(outB));
+					_mm_storeu_ps(pTarget + 8, _mm256_castps256_ps128(outC));
+					_mm_storeu_ps(pTarget + 12, _mm256_extractf128_ps(outA, 1));
+					_mm_storeu_ps(pTarget + 16, _mm256_extractf128_ps(outB, 1));
+					_mm_storeu_ps(pTarget + 20, _mm256_extractf128_ps(outC, 1));
+				}
+			}
 
-	Vector4 Matrix::TransformPoint(const Vector4& p) const
-	{
-		return TransformPoint(p.x, p.y, p.z, p.w);
-	}
+			__m128 rows[4][3]{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 3; ++c)
+				{
+					rows[r][c] = _mm_set1_ps(m[r][c]);
+				}
+			}
 
-	Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
-	{
-		return Vector4{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-			data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
-		};
-	}
+			for (; i + 4 <= count; i += 4)
+			{
+				const float* pSource{ pIn + i * 3 };
+				__m128 x, y, z;
+				ToLanesSSE(_mm_loadu_ps(pSource), _mm_loadu_ps(pSource + 4), _mm_loadu_ps(pSource + 8), x, y, z);
+
+				__m128 result[3];
+				for (int column{ 0 }; column < 3; ++column)
+				{
+					const __m128 xy{ _mm_add_ps(_mm_mul_ps(rows[0][column], x), _mm_mul_ps(rows[1][column], y)) };
+					result[column] = _mm_add_ps(xy, _mm_mul_ps(rows[2][column], z));
+					if constexpr (IsPoint) result[column] = _mm_add_ps(result[column], rows[3][column]);
+				}
+
+				__m128 outA, outB, outC;
+				FromLanesSSE(result[0], result[1], result[2], outA, outB, outC);
+				float* pTarget{ pOut + i * 3 };
+				_mm_storeu_ps(pTarget, outA);
+				_mm_storeu_ps(pTarget + 4, outB);
+				_mm_storeu_ps(pTarget + 8, outC);
+			}
 
-	const Matrix& Matrix::Transpose()
-	{
-		Matrix result{};
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
+			for (; i < count; ++i)
 			{
-				result[r][c] = data[c][r];
+				if constexpr (IsPoint) out[i] = m.TransformPoint(in[i]);
+				else out[i] = m.TransformVector(in[i]);
 			}
 		}
-
-		data[0] = result[0];
-		data[1] = result[1];
-		data[2] = result[2];
-		data[3] = result[3];
-
-		return *this;
-	}
-
-	const Matrix& Matrix::Inverse()
-	{
-		//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
-		const Vector3& a = data[0];
-		const Vector3& b = data[1];
-		const Vector3& c = data[2];
-		const Vector3& d = data[3];
-
-		const float x = data[0][3];
-		const float y = data[1][3];
-		const float z = data[2][3];
-		const float w = data[3][3];
-
-		Vector3 s = Vector3::Cross(a, b);
-		Vector3 t = Vector3::Cross(c, d);
-		Vector3 u = a * y - b * x;
-		Vector3 v = c * w - d * z;
-
-		const float det = Vector3::Dot(s, v) + Vector3::Dot(t, u);
-		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
-		const float invDet = 1.f / det;
-
-		s *= invDet; t *= invDet; u *= invDet; v *= invDet;
-
-		const Vector3 r0 = Vector3::Cross(b, v) + t * y;
-		const Vector3 r1 = Vector3::Cross(v, a) - t * x;
-		const Vector3 r2 = Vector3::Cross(d, u) + s * w;
-		//Vector3 r3 = Vector3::Cross(u, c) - s * z;
-
-		data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
-		data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
-		data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
-		data[3] = {-Vector3::Dot(b, t),Vector3::Dot(a, t),-Vector3::Dot(d, s),Vector3::Dot(c, s) };
-
-		return *this;
-	}
-
-	Matrix Matrix::Transpose(const Matrix& m)
-	{
-		Matrix out{ m };
-		out.Transpose();
-
-		return out;
-	}
-
-	Matrix Matrix::Inverse(const Matrix& m)
-	{
-		Matrix out{ m };
-		out.Inverse();
-
-		return out;
-	}
-
-	Matrix Matrix::CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
-	{
-		assert(false && "Not Implemented");
-		return {};
-	}
-
-	Matrix Matrix::CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
-	{
-		Matrix projectionMatrix{
-			Vector4{1 / (aspect * fov), 0, 0, 0},
-			Vector4{0, 1 / fov, 0, 0},
-			Vector4{0, 0, zf / (zf - zn), 1},
-			Vector4{0,0,-(zf * zn) / (zf - zn), 0}
-		};
-
-		return projectionMatrix;
-	}
-
-	Vector3 Matrix::GetAxisX() const
-	{
-		return data[0];
-	}
-
-	Vector3 Matrix::GetAxisY() const
-	{
-		return data[1];
-	}
-
-	Vector3 Matrix::GetAxisZ() const
-	{
-		return data[2];
-	}
-
-	Vector3 Matrix::GetTranslation() const
-	{
-		return data[3];
-	}
-
-	Matrix Matrix::CreateTranslation(float x, float y, float z)
-	{
-		return CreateTranslation({ x, y, z });
-	}
-
-	Matrix Matrix::CreateTranslation(const Vector3& t)
-	{
-		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
-	}
-
-	Matrix Matrix::CreateRotationX(float pitch)
-	{
-		return {
-			{1, 0, 0, 0},
-			{0, cos(pitch), -sin(pitch), 0},
-			{0, sin(pitch), cos(pitch), 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotationY(float yaw)
-	{
-		return {
-			{cos(yaw), 0, -sin(yaw), 0},
-			{0, 1, 0, 0},
-			{sin(yaw), 0, cos(yaw), 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotationZ(float roll)
-	{
-		return {
-			{cos(roll), sin(roll), 0, 0},
-			{-sin(roll), cos(roll), 0, 0},
-			{0, 0, 1, 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotation(float pitch, float yaw, float roll)
-	{
-		return CreateRotation({ pitch, yaw, roll });
-	}
-
-	Matrix Matrix::CreateRotation(const Vector3& r)
-	{
-		return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
 	}
 
-	Matrix Matrix::CreateScale(float sx, float sy, float sz)
+	void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const
 	{
-		return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
+		TransformVector3s<true>(*this, points, out);
 	}
 
-	Matrix Matrix::CreateScale(const Vector3& s)
+	void Matrix::TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const
 	{
-		return CreateScale(s[0], s[1], s[2]);
+		TransformVector3s<false>(*this, vectors, out);
 	}
 
-#pragma region Operator Overloads
-	Vector4& Matrix::operator[](int index)
+	//Like TransformPoint(Vector4), w is taken as 1
+	void Matrix::TransformPoints(std::span<const Vector4> points, std::span<Vector4> out) const
 	{
-		assert(index <= 3 && index >= 0);
-		return data[index];
-	}
-
-	Vector4 Matrix::operator[](int index) const
-	{
-		assert(index <= 3 && index >= 0);
-		return data[index];
-	}
+		assert(out.size() >= points.size() && "ERROR: the output of a batch transform is smaller than its input");
+		const int count{ static_cast<int>(points.size()) };
+		const float* pIn{ &points.data()->x };
+		float* pOut{ &out.data()->x };
 
-	Matrix Matrix::operator*(const Matrix& m) const
-	{
-		Matrix result{};
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
+		int i{ 0 };
+		if (HasAVX())
 		{
-			for (int c{ 0 }; c < 4; ++c)
+			//2 points per register, every 128 bit lane broadcasts its own point's x, y and z
+			const __m256 xAxis{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[0].x)) };
+			const __m256 yAxis{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[1].x)) };
+			const __m256 zAxis{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[2].x)) };
+			const __m256 translation{ _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&data[3].x)) };
+
+			for (; i + 2 <= count; i += 2)
 			{
-				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+				const __m256 point{ _mm256_loadu_ps(pIn + i * 4) };
+				const __m256 xy{ _mm256_add_ps(_mm256_mul_ps(xAxis, _mm256_permute_ps(point, 0x00)), _mm256_mul_ps(yAxis, _mm256_permute_ps(point, 0x55))) };
+				const __m256 result{ _mm256_add_ps(_mm256_add_ps(xy, _mm256_mul_ps(zAxis, _mm256_permute_ps(point, 0xAA))), translation) };
+				_mm256_storeu_ps(pOut + i * 4, result);
 			}
 		}
 
-		return result;
-	}
-
-	const Matrix& Matrix::operator*=(const Matrix& m)
-	{
-		Matrix copy{ *this };
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
+		const __m128 translation{ _mm_loadu_ps(&data[3].x) };
+		for (; i < count; ++i)
 		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
-			}
+			const __m128 point{ _mm_loadu_ps(pIn + i * 4) };
+			const __m128 x{ _mm_shuffle_ps(point, point, _MM_SHUFFLE(0, 0, 0, 0)) };
+			const __m128 y{ _mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1)) };
+			const __m128 z{ _mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2)) };
+			_mm_storeu_ps(pOut + i * 4, TransformRowsSSE(x, y, z, translation));
 		}
-
-		return *this;
 	}
-#pragma endregion
-}
\ No newline at end of file
+}
@@ -1,62 +1,400 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <span>
+#include <type_traits>
+#include <immintrin.h>
+#include "MathHelpers.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
 namespace dae {
+	//Header-only and trivially copyable, so matrices are passed around as plain data and every transform can be inlined
+	//Everything but the rotations is constexpr, constant matrices fold at compile time
+	//At run time the 4 wide transforms and the multiply use SSE, with the same operations in the same order as the scalar code
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-
-		Vector4 TransformPoint(const Vector4& p) const;
-		Vector4 TransformPoint(float x, float y, float z, float w) const;
-
-		const Matrix& Transpose();
-		const Matrix& Inverse();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-		static Matrix Inverse(const Matrix& m);
-
-		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
-		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		constexpr Vector4 TransformPoint(const Vector4& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z, p.w);
+		}
+
+		constexpr Vector4 TransformPoint(float x, float y, float z, float w) const
+		{
+			if (!std::is_constant_evaluated())
+			{
+				Vector4 result{};
+				_mm_storeu_ps(&result.x, TransformRowsSSE(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_loadu_ps(&data[3].x)));
+				return result;
+			}
+
+			return Vector4{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+				data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
+			};
+		}
+
+		//Whole arrays in one call, the matrix stays in registers and 8 elements are transformed at once with AVX, 4 with SSE
+		//The results are identical to transforming the elements one by one, out is at least as large as the input and may be the input
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const;
+		void TransformPoints(std::span<const Vector4> points, std::span<Vector4> out) const;
+		void TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const;
+
+		constexpr const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		constexpr const Matrix& Inverse()
+		{
+			//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
+			const Vector3 a = data[0];
+			const Vector3 b = data[1];
+			const Vector3 c = data[2];
+			const Vector3 d = data[3];
+
+			const float x = data[0][3];
+			const float y = data[1][3];
+			const float z = data[2][3];
+			const float w = data[3][3];
+
+			Vector3 s = Vector3::Cross(a, b);
+			Vector3 t = Vector3::Cross(c, d);
+			Vector3 u = a * y - b * x;
+			Vector3 v = c * w - d * z;
+
+			const float det = Vector3::Dot(s, v) + Vector3::Dot(t, u);
+			assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+			const float invDet = 1.f / det;
+
+			s *= invDet; t *= invDet; u *= invDet; v *= invDet;
+
+			const Vector3 r0 = Vector3::Cross(b, v) + t * y;
+			const Vector3 r1 = Vector3::Cross(v, a) - t * x;
+			const Vector3 r2 = Vector3::Cross(d, u) + s * w;
+			//Vector3 r3 = Vector3::Cross(u, c) - s * z;
+
+			data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
+			data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
+			data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
+			data[3] = { -Vector3::Dot(b, t),Vector3::Dot(a, t),-Vector3::Dot(d, s),Vector3::Dot(c, s) };
+
+			return *this;
+		}
+
+		//Inverse of a matrix without projection, the last column is (0, 0, 0, 1): the 3x3 part is inverted on its own and the translation follows from it
+		constexpr const Matrix& InverseAffine()
+		{
+			assert(IsAffine() && "ERROR: InverseAffine needs a matrix without projection");
+			const Vector3 a = data[0];
+			const Vector3 b = data[1];
+			const Vector3 c = data[2];
+			const Vector3 t = data[3];
+
+			const Vector3 bc = Vector3::Cross(b, c);
+			const float det = Vector3::Dot(a, bc);
+			assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+			const float invDet = 1.f / det;
+
+			//Columns of the inverted 3x3 part
+			const Vector3 c0 = bc * invDet;
+			const Vector3 c1 = Vector3::Cross(c, a) * invDet;
+			const Vector3 c2 = Vector3::Cross(a, b) * invDet;
+
+			data[0] = Vector4{ c0.x, c1.x, c2.x, 0.f };
+			data[1] = Vector4{ c0.y, c1.y, c2.y, 0.f };
+			data[2] = Vector4{ c0.z, c1.z, c2.z, 0.f };
+			data[3] = Vector4{ -Vector3::Dot(t, c0), -Vector3::Dot(t, c1), -Vector3::Dot(t, c2), 1.f };
+
+			return *this;
+		}
+
+		//Inverse of a rotation and a translation, like a camera: the 3x3 part is transposed and the translation rotated back
+		constexpr const Matrix& InverseOrthonormal()
+		{
+			assert(IsAffine() && "ERROR: InverseOrthonormal needs a matrix without projection");
+			const Vector3 a = data[0];
+			const Vector3 b = data[1];
+			const Vector3 c = data[2];
+			const Vector3 t = data[3];
+
+			data[0] = Vector4{ a.x, b.x, c.x, 0.f };
+			data[1] = Vector4{ a.y, b.y, c.y, 0.f };
+			data[2] = Vector4{ a.z, b.z, c.z, 0.f };
+			data[3] = Vector4{ -Vector3::Dot(t, a), -Vector3::Dot(t, b), -Vector3::Dot(t, c), 1.f };
+
+			return *this;
+		}
+
+		constexpr bool IsAffine() const
+		{
+			return data[0].w == 0.f && data[1].w == 0.f && data[2].w == 0.f && data[3].w == 1.f;
+		}
+
+		//Rotation, uniform scale and translation only: the axes are perpendicular and equally long, so angles between vectors are kept
+		//tolerance is relative to the squared axis length
+		constexpr bool IsConformal(float tolerance = 1e-3f) const
+		{
+			const Vector3 a = data[0];
+			const Vector3 b = data[1];
+			const Vector3 c = data[2];
+			const float sqrLength = a.SqrMagnitude();
+			const float maxError = tolerance * sqrLength;
+
+			const auto isSmall = [maxError](float value) { return value <= maxError && value >= -maxError; };
+			return IsAffine() && sqrLength > 0.f
+				&& isSmall(b.SqrMagnitude() - sqrLength) && isSmall(c.SqrMagnitude() - sqrLength)
+				&& isSmall(Vector3::Dot(a, b)) && isSmall(Vector3::Dot(b, c)) && isSmall(Vector3::Dot(c, a));
+		}
+
+		constexpr Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		constexpr Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		constexpr Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		constexpr Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return CreateTranslation({ x, y, z });
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			return {
+				{1, 0, 0, 0},
+				{0, std::cos(pitch), -std::sin(pitch), 0},
+				{0, std::sin(pitch), std::cos(pitch), 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			return {
+				{std::cos(yaw), 0, -std::sin(yaw), 0},
+				{0, 1, 0, 0},
+				{std::sin(yaw), 0, std::cos(yaw), 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			return {
+				{std::cos(roll), std::sin(roll), 0, 0},
+				{-std::sin(roll), std::cos(roll), 0, 0},
+				{0, 0, 1, 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return { Vector3{sx, 0, 0}, Vector3{0, sy, 0}, Vector3{0, 0, sz}, Vector3::Zero };
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s[0], s[1], s[2]);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static constexpr Matrix Inverse(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Inverse();
+
+			return out;
+		}
+
+		static constexpr Matrix InverseAffine(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.InverseAffine();
+
+			return out;
+		}
+
+		static constexpr Matrix InverseOrthonormal(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.InverseOrthonormal();
+
+			return out;
+		}
+
+		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
+		{
+			assert(false && "Not Implemented");
+			return {};
+		}
+
+		static constexpr Matrix CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
+		{
+			Matrix projectionMatrix{
+				Vector4{1 / (aspect * fov), 0, 0, 0},
+				Vector4{0, 1 / fov, 0, 0},
+				Vector4{0, 0, zf / (zf - zn), 1},
+				Vector4{0,0,-(zf * zn) / (zf - zn), 0}
+			};
+
+			return projectionMatrix;
+		}
+
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+
+			if (!std::is_constant_evaluated())
+			{
+				//Every row of the result is the row of this matrix transforming the rows of m
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					const __m128 w{ _mm_mul_ps(_mm_set1_ps(data[r].w), _mm_loadu_ps(&m.data[3].x)) };
+					_mm_storeu_ps(&result.data[r].x, m.TransformRowsSSE(_mm_set1_ps(data[r].x), _mm_set1_ps(data[r].y), _mm_set1_ps(data[r].z), w));
+				}
+				return result;
+			}
+
+			Matrix m_transposed = Transpose(m);
+
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+				}
+			}
+
+			return result;
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+
+			return *this;
+		}
 
 	private:
+		//x * xAxis + y * yAxis + z * zAxis + last, summed left to right like the scalar transforms
+		__m128 TransformRowsSSE(__m128 x, __m128 y, __m128 z, __m128 last) const
+		{
+			const __m128 xy{ _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data[0].x), x), _mm_mul_ps(_mm_loadu_ps(&data[1].x), y)) };
+			return _mm_add_ps(_mm_add_ps(xy, _mm_mul_ps(_mm_loadu_ps(&data[2].x), z)), last);
+		}
+
 
 		//Row-Major Matrix
 		Vector4 data[4]
@@ -72,4 +410,6 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+
+	static_assert(std::is_trivially_copyable_v<Matrix>, "Matrices are copied around as plain data");
+}
@@ -366,6 +366,40 @@ namespace dae
 		, m_WorldMatrix{ worldMatrix }
 		, m_topology{topology}
 	{
+		//Split the vertices into one stream per component for the batched vertex transform
+		const size_t numVertices{ m_VerticesTex.size() };
+		std::vector<float>* pStreams[]{
+			&m_VertexStreams.positionX, &m_VertexStreams.positionY, &m_VertexStreams.positionZ,
+			&m_VertexStreams.u, &m_VertexStreams.v,
+			&m_VertexStreams.normalX, &m_VertexStreams.normalY, &m_VertexStreams.normalZ,
+			&m_VertexStreams.tangentX, &m_VertexStreams.tangentY, &m_VertexStreams.tangentZ,
+			&m_VertexStreams.binormalX, &m_VertexStreams.binormalY, &m_VertexStreams.binormalZ };
+		for (std::vector<float>* pStream : pStreams)
+		{
+			pStream->resize(numVertices);
+		}
+
+		for (size_t i{}; i < numVertices; ++i)
+		{
+			const Vertex_PosTex& vertex{ m_VerticesTex[i] };
+			m_VertexStreams.positionX[i] = vertex.position.x;
+			m_VertexStreams.positionY[i] = vertex.position.y;
+			m_VertexStreams.positionZ[i] = vertex.position.z;
+			m_VertexStreams.u[i] = vertex.TexCoord.x;
+			m_VertexStreams.v[i] = vertex.TexCoord.y;
+			m_VertexStreams.normalX[i] = vertex.normal.x;
+			m_VertexStreams.normalY[i] = vertex.normal.y;
+			m_VertexStreams.normalZ[i] = vertex.normal.z;
+			m_VertexStreams.tangentX[i] = vertex.tangent.x;
+			m_VertexStreams.tangentY[i] = vertex.tangent.y;
+			m_VertexStreams.tangentZ[i] = vertex.tangent.z;
+
+			//The OBJ tangents carry no handedness, so like the shader the binormal is always Cross(normal, tangent)
+			const Vector3 binormal{ Vector3::Cross(vertex.normal, vertex.tangent).Normalized() };
+			m_VertexStreams.binormalX[i] = binormal.x;
+			m_VertexStreams.binormalY[i] = binormal.y;
+			m_VertexStreams.binormalZ[i] = binormal.z;
+		}
 	}
 
 	//===================================================================================================================================
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "DataTypes.h"
 #include "Effect.h"
 #include "Camera.h"
@@ -41,8 +43,8 @@ namespace dae
 		void CycleSamplerState();
 		void CycleCullingMode();
 
-		std::vector<Vertex_PosTex> GetVertices() const { return m_VerticesTex; };
-		std::vector<uint32_t> GetIndices() const { return m_Indices; };
+		std::span<const Vertex_PosTex> GetVertices() const { return m_VerticesTex; };
+		std::span<const uint32_t> GetIndices() const { return m_Indices; };
 
 		Matrix m_WorldMatrix{};
 
@@ -66,16 +68,19 @@ namespace dae
 	public:
 		Mesh_PosTexSoftwareVehicle(std::vector<Vertex_PosTex> vertices, std::vector<uint32_t> indices, const Matrix& worldMatrix, PrimitiveTopology topology);
 
-		std::vector<Vertex_PosTex> GetVertices() const { return m_VerticesTex; };
-		std::vector<uint32_t> GetIndices() const { return m_Indices; };
+		std::span<const Vertex_PosTex> GetVertices() const { return m_VerticesTex; };
+		std::span<const uint32_t> GetIndices() const { return m_Indices; };
+		const VertexStreams& GetVertexStreams() const { return m_VertexStreams; };
 
 		Matrix m_WorldMatrix{};
 		std::vector<Vertex_Out> m_Vertices_out{};
+		std::vector<Vertex_Raster> m_VerticesRaster_out{};
 		PrimitiveTopology m_topology{ PrimitiveTopology::TriangleList };
 
 	private:
 		std::vector<Vertex_PosTex> m_VerticesTex;
 		std::vector<uint32_t> m_Indices;
+		VertexStreams m_VertexStreams{};
 		int m_NumIndices{};
 	};
 	//I could have used inheritance again here, but I was running short on time, so sorry
@@ -89,6 +94,9 @@ namespace dae
 		void Render(ID3D11DeviceContext* pDeviceContext, const Camera& camera);
 		void CycleSamplerState();
 
+		std::span<const Vertex_PosTex> GetVertices() const { return m_VerticesTex; };
+		std::span<const uint32_t> GetIndices() const { return m_Indices; };
+
 		Matrix m_WorldMatrix{};
 
 	private:
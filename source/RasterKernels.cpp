@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "RasterKernels.h"
+
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace RasterKernels
+	{
+		//Every kernel is instantiated per depth test, the weights are only stored when there is a result to store them in
+		enum class DepthTest
+		{
+			lessEqual,	//writes the depth of the passing lanes
+			equal		//read only
+		};
+
+		//The scalar kernel is the reference, the SIMD kernels do the exact same operations in the same order
+		template<DepthTest Test>
+		static uint32_t CoverageDepthScalarT(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult* pResult)
+		{
+			uint32_t passMask{ 0 };
+
+			for (int lane{}; lane < BlockWidth; ++lane)
+			{
+				if ((laneMask & (1u << lane)) == 0) continue;
+
+				const int32_t fixedEdge0{ setup.fixedEdge[0] + setup.fixedEdgeStepX[0] * lane };
+				const int32_t fixedEdge1{ setup.fixedEdge[1] + setup.fixedEdgeStepX[1] * lane };
+				const int32_t fixedEdge2{ setup.fixedEdge[2] + setup.fixedEdgeStepX[2] * lane };
+
+				if ((fixedEdge0 | fixedEdge1 | fixedEdge2) < 0) continue;
+
+				const float laneOffset{ static_cast<float>(lane) };
+				const float edge0{ setup.edge[0] + setup.edgeStepX[0] * laneOffset };
+				const float edge1{ setup.edge[1] + setup.edgeStepX[1] * laneOffset };
+				const float edge2{ setup.edge[2] + setup.edgeStepX[2] * laneOffset };
+
+				const float weight0{ edge0 * setup.invArea };
+				const float weight1{ edge1 * setup.invArea };
+				const float weight2{ edge2 * setup.invArea };
+
+				const float interpolatedZDepth{ setup.z[0] * weight0 + setup.z[1] * weight1 + setup.z[2] * weight2 };
+
+				if (interpolatedZDepth < 0 || interpolatedZDepth > 1) continue; //Frustum culling for z
+
+				if constexpr (Test == DepthTest::lessEqual)
+				{
+					if (pDepth[lane] < interpolatedZDepth) continue; //Depth test
+					pDepth[lane] = interpolatedZDepth; //Depth write
+				}
+				else
+				{
+					if (pDepth[lane] != interpolatedZDepth) continue; //Only the fragment the prepass kept
+				}
+
+				if (pResult)
+				{
+					pResult->weight[0][lane] = weight0;
+					pResult->weight[1][lane] = weight1;
+					pResult->weight[2][lane] = weight2;
+					pResult->depth[lane] = interpolatedZDepth;
+				}
+				passMask |= 1u << lane;
+			}
+
+			return passMask;
+		}
+
+		template<DepthTest Test>
+		static uint32_t CoverageDepthSSE41T(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult* pResult)
+		{
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 invArea{ _mm_set1_ps(setup.invArea) };
+			const __m128i laneBits{ _mm_setr_epi32(1, 2, 4, 8) };
+
+			uint32_t passMask{ 0 };
+
+			//Two halves of 4 lanes
+			for (int half{}; half < 2; ++half)
+			{
+				const int firstLane{ half * 4 };
+				const uint32_t halfLaneMask{ (laneMask >> firstLane) & 0xF };
+				if (halfLaneMask == 0) continue;
+
+				const __m128i fixedLaneOffset{ _mm_setr_epi32(firstLane, firstLane + 1, firstLane + 2, firstLane + 3) };
+				const __m128 laneOffset{ _mm_cvtepi32_ps(fixedLaneOffset) };
+
+				//Covered when the sign bit of all three fixed point edges is clear
+				const __m128i fixedEdge0{ _mm_add_epi32(_mm_set1_epi32(setup.fixedEdge[0]), _mm_mullo_epi32(_mm_set1_epi32(setup.fixedEdgeStepX[0]), fixedLaneOffset)) };
+				const __m128i fixedEdge1{ _mm_add_epi32(_mm_set1_epi32(setup.fixedEdge[1]), _mm_mullo_epi32(_mm_set1_epi32(setup.fixedEdgeStepX[1]), fixedLaneOffset)) };
+				const __m128i fixedEdge2{ _mm_add_epi32(_mm_set1_epi32(setup.fixedEdge[2]), _mm_mullo_epi32(_mm_set1_epi32(setup.fixedEdgeStepX[2]), fixedLaneOffset)) };
+				const __m128i fixedEdges{ _mm_or_si128(_mm_or_si128(fixedEdge0, fixedEdge1), fixedEdge2) };
+				__m128 pass{ _mm_castsi128_ps(_mm_cmpgt_epi32(fixedEdges, _mm_set1_epi32(-1))) };
+
+				const __m128 edge0{ _mm_add_ps(_mm_set1_ps(setup.edge[0]), _mm_mul_ps(_mm_set1_ps(setup.edgeStepX[0]), laneOffset)) };
+				const __m128 edge1{ _mm_add_ps(_mm_set1_ps(setup.edge[1]), _mm_mul_ps(_mm_set1_ps(setup.edgeStepX[1]), laneOffset)) };
+				const __m128 edge2{ _mm_add_ps(_mm_set1_ps(setup.edge[2]), _mm_mul_ps(_mm_set1_ps(setup.edgeStepX[2]), laneOffset)) };
+
+				const __m128i lanes{ _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(halfLaneMask)), laneBits), laneBits) };
+				pass = _mm_and_ps(pass, _mm_castsi128_ps(lanes));
+				if (_mm_movemask_ps(pass) == 0) continue;
+
+				const __m128 weight0{ _mm_mul_ps(edge0, invArea) };
+				const __m128 weight1{ _mm_mul_ps(edge1, invArea) };
+				const __m128 weight2{ _mm_mul_ps(edge2, invArea) };
+
+				const __m128 depth{ _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(setup.z[0]), weight0),
+					_mm_mul_ps(_mm_set1_ps(setup.z[1]), weight1)),
+					_mm_mul_ps(_mm_set1_ps(setup.z[2]), weight2)) };
+
+				//Negated compares so NaN behaves like the scalar "continue" tests
+				pass = _mm_and_ps(pass, _mm_and_ps(_mm_cmpnlt_ps(depth, zero), _mm_cmpngt_ps(depth, one)));
+
+				float* pHalfDepth{ pDepth + firstLane };
+				const __m128 storedDepth{ _mm_loadu_ps(pHalfDepth) };
+				if constexpr (Test == DepthTest::lessEqual)
+				{
+					pass = _mm_and_ps(pass, _mm_cmpnlt_ps(storedDepth, depth));
+
+					//Every lane of the block belongs to the calling tile, so writing back the old values is safe
+					_mm_storeu_ps(pHalfDepth, _mm_blendv_ps(storedDepth, depth, pass));
+				}
+				else
+				{
+					pass = _mm_and_ps(pass, _mm_cmpeq_ps(storedDepth, depth));
+				}
+
+				if (pResult)
+				{
+					_mm_storeu_ps(&pResult->weight[0][firstLane], weight0);
+					_mm_storeu_ps(&pResult->weight[1][firstLane], weight1);
+					_mm_storeu_ps(&pResult->weight[2][firstLane], weight2);
+					_mm_storeu_ps(&pResult->depth[firstLane], depth);
+				}
+
+				passMask |= static_cast<uint32_t>(_mm_movemask_ps(pass)) << firstLane;
+			}
+
+			return passMask;
+		}
+
+		template<DepthTest Test>
+		static uint32_t CoverageDepthAVX2T(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult* pResult)
+		{
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256i fixedLaneOffset{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+			const __m256 laneOffset{ _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+			const __m256i laneBits{ _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128) };
+
+			//Covered when the sign bit of all three fixed point edges is clear
+			const __m256i fixedEdge0{ _mm256_add_epi32(_mm256_set1_epi32(setup.fixedEdge[0]), _mm256_mullo_epi32(_mm256_set1_epi32(setup.fixedEdgeStepX[0]), fixedLaneOffset)) };
+			const __m256i fixedEdge1{ _mm256_add_epi32(_mm256_set1_epi32(setup.fixedEdge[1]), _mm256_mullo_epi32(_mm256_set1_epi32(setup.fixedEdgeStepX[1]), fixedLaneOffset)) };
+			const __m256i fixedEdge2{ _mm256_add_epi32(_mm256_set1_epi32(setup.fixedEdge[2]), _mm256_mullo_epi32(_mm256_set1_epi32(setup.fixedEdgeStepX[2]), fixedLaneOffset)) };
+			const __m256i fixedEdges{ _mm256_or_si256(_mm256_or_si256(fixedEdge0, fixedEdge1), fixedEdge2) };
+			__m256 pass{ _mm256_castsi256_ps(_mm256_cmpgt_epi32(fixedEdges, _mm256_set1_epi32(-1))) };
+
+			const __m256 edge0{ _mm256_add_ps(_mm256_set1_ps(setup.edge[0]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStepX[0]), laneOffset)) };
+			const __m256 edge1{ _mm256_add_ps(_mm256_set1_ps(setup.edge[1]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStepX[1]), laneOffset)) };
+			const __m256 edge2{ _mm256_add_ps(_mm256_set1_ps(setup.edge[2]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStepX[2]), laneOffset)) };
+
+			const __m256i lanes{ _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(laneMask)), laneBits), laneBits) };
+			pass = _mm256_and_ps(pass, _mm256_castsi256_ps(lanes));
+			if (_mm256_movemask_ps(pass) == 0) return 0;
+
+			const __m256 invArea{ _mm256_set1_ps(setup.invArea) };
+			const __m256 weight0{ _mm256_mul_ps(edge0, invArea) };
+			const __m256 weight1{ _mm256_mul_ps(edge1, invArea) };
+			const __m256 weight2{ _mm256_mul_ps(edge2, invArea) };
+
+			const __m256 depth{ _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(setup.z[0]), weight0),
+				_mm256_mul_ps(_mm256_set1_ps(setup.z[1]), weight1)),
+				_mm256_mul_ps(_mm256_set1_ps(setup.z[2]), weight2)) };
+
+			//Negated compares so NaN behaves like the scalar "continue" tests
+			pass = _mm256_and_ps(pass, _mm256_and_ps(_mm256_cmp_ps(depth, zero, _CMP_NLT_UQ), _mm256_cmp_ps(depth, one, _CMP_NGT_UQ)));
+
+			const __m256 storedDepth{ _mm256_loadu_ps(pDepth) };
+			if constexpr (Test == DepthTest::lessEqual)
+			{
+				pass = _mm256_and_ps(pass, _mm256_cmp_ps(storedDepth, depth, _CMP_NLT_UQ));
+				_mm256_maskstore_ps(pDepth, _mm256_castps_si256(pass), depth);
+			}
+			else
+			{
+				pass = _mm256_and_ps(pass, _mm256_cmp_ps(storedDepth, depth, _CMP_EQ_OQ));
+			}
+
+			if (pResult)
+			{
+				_mm256_storeu_ps(pResult->weight[0], weight0);
+				_mm256_storeu_ps(pResult->weight[1], weight1);
+				_mm256_storeu_ps(pResult->weight[2], weight2);
+				_mm256_storeu_ps(pResult->depth, depth);
+			}
+
+			return static_cast<uint32_t>(_mm256_movemask_ps(pass));
+		}
+
+		uint32_t CoverageDepthScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthScalarT<DepthTest::lessEqual>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t CoverageDepthSSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthSSE41T<DepthTest::lessEqual>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t CoverageDepthAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthAVX2T<DepthTest::lessEqual>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t CoverageDepthEqualScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthScalarT<DepthTest::equal>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t CoverageDepthEqualSSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthSSE41T<DepthTest::equal>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t CoverageDepthEqualAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result)
+		{
+			return CoverageDepthAVX2T<DepthTest::equal>(setup, laneMask, pDepth, &result);
+		}
+
+		uint32_t DepthOnlyScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth)
+		{
+			return CoverageDepthScalarT<DepthTest::lessEqual>(setup, laneMask, pDepth, nullptr);
+		}
+
+		uint32_t DepthOnlySSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth)
+		{
+			return CoverageDepthSSE41T<DepthTest::lessEqual>(setup, laneMask, pDepth, nullptr);
+		}
+
+		uint32_t DepthOnlyAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth)
+		{
+			return CoverageDepthAVX2T<DepthTest::lessEqual>(setup, laneMask, pDepth, nullptr);
+		}
+
+		const KernelSet& GetScalarKernels()
+		{
+			static const KernelSet scalarKernels{ "scalar", &CoverageDepthScalar, &CoverageDepthEqualScalar, &DepthOnlyScalar };
+			return scalarKernels;
+		}
+
+		const KernelSet& SelectKernels()
+		{
+			static const KernelSet sse41Kernels{ "SSE4.1", &CoverageDepthSSE41, &CoverageDepthEqualSSE41, &DepthOnlySSE41 };
+			static const KernelSet avx2Kernels{ "AVX2", &CoverageDepthAVX2, &CoverageDepthEqualAVX2, &DepthOnlyAVX2 };
+
+			if (SDL_HasAVX2()) return avx2Kernels;
+			if (SDL_HasSSE41()) return sse41Kernels;
+			return GetScalarKernels();
+		}
+	}
+}
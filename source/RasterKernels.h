@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	namespace RasterKernels
+	{
+		//Number of horizontally adjacent pixels one kernel call handles
+		constexpr int BlockWidth{ 8 };
+
+		//Fixed point edges further away than this are clamped, a block's lanes never span more than a few sub-pixel steps times the edge's slope
+		constexpr int64_t MaxFixedEdge{ 1 << 30 };
+
+		struct BlockSetup
+		{
+			int32_t fixedEdge[3];		//fixed point edge values at the first lane, biased by the fill rule, covered when >= 0
+			int32_t fixedEdgeStepX[3];	//fixed point edge increment per pixel
+			float edge[3];				//edge values at the first lane, only used for the weights
+			float edgeStepX[3];			//edge increment per pixel
+			float invArea;
+			float z[3];			//depth of the vertices, z / w is linear in screen space
+		};
+
+		struct BlockResult
+		{
+			float weight[3][BlockWidth];
+			float depth[BlockWidth];
+		};
+
+		//Coverage, depth range and depth test for one block of pixels starting at pDepth
+		//Triangles are culled and flipped at setup, a pixel is covered when all fixed point edges are >= 0
+		//Depth is written for the lanes that pass, the returned mask has one bit per passing lane
+		//laneMask limits the lanes that are considered, the SIMD kernels still load all 8 depth values
+		using CoverageDepthKernel = uint32_t(*)(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+		//Same coverage and depth, without the weights, for passes that only fill the depth buffer
+		using DepthOnlyKernel = uint32_t(*)(const BlockSetup& setup, uint32_t laneMask, float* pDepth);
+
+		uint32_t CoverageDepthScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+		uint32_t CoverageDepthSSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+		uint32_t CoverageDepthAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+
+		//Lanes pass when their depth equals the stored depth, nothing is written, for the colour pass after a depth prepass
+		uint32_t CoverageDepthEqualScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+		uint32_t CoverageDepthEqualSSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+		uint32_t CoverageDepthEqualAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth, BlockResult& result);
+
+		uint32_t DepthOnlyScalar(const BlockSetup& setup, uint32_t laneMask, float* pDepth);
+		uint32_t DepthOnlySSE41(const BlockSetup& setup, uint32_t laneMask, float* pDepth);
+		uint32_t DepthOnlyAVX2(const BlockSetup& setup, uint32_t laneMask, float* pDepth);
+
+		//The kernels of one instruction set, the depth values they compute are identical so passes can be mixed
+		struct KernelSet
+		{
+			const char* name;
+			CoverageDepthKernel pCoverageDepth;
+			CoverageDepthKernel pCoverageDepthEqual;
+			DepthOnlyKernel pDepthOnly;
+		};
+
+		const KernelSet& GetScalarKernels();
+		//Picks the widest kernels the CPU supports
+		const KernelSet& SelectKernels();
+	}
+}
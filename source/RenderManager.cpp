@@ -2,6 +2,7 @@
 #include "RenderManager.h"
 #include "Utils.h"
 #include "DataTypes.h"
+#include "MathBenchmark.h"
 
 namespace dae
 {
@@ -23,10 +24,13 @@ namespace dae
 		Texture* pNormal = Texture::LoadFromFile("Resources/vehicle_normal.png");
 		Texture* pSpecular = Texture::LoadFromFile("Resources/vehicle_specular.png");
 		Texture* pGloss = Texture::LoadFromFile("Resources/vehicle_gloss.png");
+		//The software renderer reads the normal, specular and gloss maps together, packed they take one fetch and half the memory
+		Texture* pMaterial = Texture::CreatePackedMaterial(pNormal, pSpecular, pGloss);
+		delete pNormal;
+		delete pSpecular;
+		delete pGloss;
 		m_pSoftwareTextures.push_back(pDiffuse);
-		m_pSoftwareTextures.push_back(pNormal);
-		m_pSoftwareTextures.push_back(pSpecular);
-		m_pSoftwareTextures.push_back(pGloss);
+		m_pSoftwareTextures.push_back(pMaterial);
 
 		//Create the different renderers
 		m_pRendererSoftware = new SoftwareRenderer(pWindow, m_pCamera, m_pSoftwareTextures);
@@ -151,6 +155,10 @@ namespace dae
 		{
 			m_pRendererHardware->CycleSamplerState();
 		}
+		else
+		{
+			m_pRendererSoftware->CycleSampleFilter();
+		}
 	}
 
 	void RenderManager::CycleShadingMode()
@@ -187,4 +195,74 @@ namespace dae
 			std::cout << "Toggled bounding box view\n";
 		}
 	}
+
+	void RenderManager::ToggleVisibilityBuffer()
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->ToggleVisibilityBuffer();
+			std::cout << "Toggled visibility buffer shading\n";
+		}
+	}
+
+	void RenderManager::ToggleDepthPrepass()
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->ToggleDepthPrepass();
+			std::cout << "Toggled depth prepass\n";
+		}
+	}
+
+	void RenderManager::ToggleFastSpecular()
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->ToggleFastSpecular();
+		}
+	}
+
+	void RenderManager::ToggleLightingSpace()
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->ToggleLightingSpace();
+		}
+	}
+
+	void RenderManager::ToggleFastNormalize()
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->ToggleFastNormalize();
+		}
+	}
+
+	void RenderManager::RunBenchmarks()
+	{
+		m_pRendererSoftware->CheckFrameAllocations(10);
+		m_pRendererSoftware->CompareRasterKernels();
+		m_pRendererSoftware->CompareWideTypes(1 << 12);
+		m_pRendererSoftware->BenchmarkVertexTransform(100);
+		m_pRendererSoftware->BenchmarkBufferLayout(10);
+		m_pRendererSoftware->CheckNearClipping();
+		m_pRendererSoftware->CompareVisibilityBuffer();
+		m_pRendererSoftware->CompareDepthPrepass();
+		m_pRendererSoftware->BenchmarkTextureFiltering(10);
+		m_pRendererSoftware->BenchmarkTextureLayout(1 << 22);
+		m_pRendererSoftware->BenchmarkBatchSampling(1 << 19);
+		m_pRendererSoftware->CompareSpecularModes(10);
+		m_pRendererSoftware->CompareLightingSpaces(10);
+		m_pRendererSoftware->CompareNormalizeModes(10);
+		m_pRendererSoftware->BenchmarkThreadScaling(30);
+		MathBenchmark::Run(1 << 16, 20);
+	}
+
+	void RenderManager::PrintRasterStats() const
+	{
+		if (m_CurrentRenderType == RenderType::Software)
+		{
+			m_pRendererSoftware->PrintRasterStats();
+		}
+	}
 }
\ No newline at end of file
@@ -37,6 +37,13 @@ namespace dae
 		void ToggleNormalMap();
 		void ToggleDepthBuffer();
 		void ToggleBoundingBoxView();
+		void ToggleVisibilityBuffer();
+		void ToggleDepthPrepass();
+		void ToggleFastSpecular();
+		void ToggleLightingSpace();
+		void ToggleFastNormalize();
+		void RunBenchmarks();
+		void PrintRasterStats() const;
 
 
 		enum class RenderType {
@@ -9,16 +9,22 @@
 #include "Matrix.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "AllocationTracker.h"
 #include <iostream>
+#include <fstream>
+#include <thread>
+#include <bit>
+#include <array>
+#include <random>
+#include <utility>
+#include <cstring>
 
 using namespace dae;
 
 SoftwareRenderer::SoftwareRenderer(SDL_Window* pWindow, Camera* pCamera, std::vector<Texture*> pTextures) :
 	BaseRenderer(pWindow, pCamera)
 	, m_pTexture{pTextures[0]}
-	, m_pNormals{pTextures[1]}
-	, m_pSpecular{pTextures[2]}
-	, m_pPhongExponent{pTextures[3]}
+	, m_pMaterial{pTextures[1]}
 {
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
@@ -28,20 +34,26 @@ SoftwareRenderer::SoftwareRenderer(SDL_Window* pWindow, Camera* pCamera, std::ve
 	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
 	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
 
-	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	CreateBuffers(m_Width, m_Height);
+
+	m_pThreadPool = new ThreadPool(static_cast<int>(std::thread::hardware_concurrency()));
+
+	m_pRasterKernels = &RasterKernels::SelectKernels();
+	std::cout << "Software rasterizer kernels: " << m_pRasterKernels->name << std::endl;
+	m_pVertexKernels = &VertexKernels::SelectKernels();
+	std::cout << "Software vertex kernels: " << m_pVertexKernels->name << std::endl;
 }
 
 SoftwareRenderer::~SoftwareRenderer()
 {
-	delete[] m_pDepthBufferPixels;
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
+
+	DeleteBuffers();
 	delete m_pTexture;
 	m_pTexture = nullptr;
-	delete m_pNormals;
-	m_pNormals = nullptr;
-	delete m_pSpecular;
-	m_pSpecular = nullptr;
-	delete m_pPhongExponent;
-	m_pPhongExponent = nullptr;
+	delete m_pMaterial;
+	m_pMaterial = nullptr;
 
 	delete m_pMesh;
 	m_pMesh = nullptr;
@@ -65,296 +77,1962 @@ void SoftwareRenderer::Render()
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
 
-	RenderMesh();
+	RenderMesh();
+	ResolveColorBuffer(m_pBackBufferPixels, m_pBackBuffer->pitch / static_cast<int>(sizeof(uint32_t)));
+
+	//@END
+	//Update SDL Surface
+	SDL_UnlockSurface(m_pBackBuffer);
+	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+
+void SoftwareRenderer::VertexTransformationFunction(const VertexStreams& vertices_in, std::vector<Vertex_Out>& vertices_out, std::vector<Vertex_Raster>& rasterVertices_out, const Matrix& meshWorldMatrix)
+{
+	const int numVertices{ static_cast<int>(vertices_in.positionX.size()) };
+	vertices_out.resize(numVertices);
+	rasterVertices_out.resize(numVertices);
+
+	//Lit in object space the camera and the light move into the mesh's space once, instead of every normal, tangent and position into world space
+	const bool isObjectSpace{ UsesObjectSpaceLighting() };
+	Vector3 cameraOrigin{ m_pCamera->origin };
+	m_ShadingLightDirection = m_Light.direction;
+	if (isObjectSpace)
+	{
+		const Matrix worldToObject{ Matrix::InverseAffine(meshWorldMatrix) };
+		cameraOrigin = worldToObject.TransformPoint(m_pCamera->origin);
+		m_ShadingLightDirection = worldToObject.TransformVector(m_Light.direction).Normalized();
+	}
+
+	const VertexKernels::TransformSetup setup{ VertexKernels::CreateTransformSetup(meshWorldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix, meshWorldMatrix, cameraOrigin, m_Width, m_Height) };
+
+	//Clip space for the clipper, raster position, 1 / w and outcode once per vertex for setup
+	//Batches of vertices are spread over the threads, every batch runs through the SIMD kernel
+	//The depth view never reads the other attributes, so only the position streams are transformed
+	VertexKernels::TransformKernel pTransformKernel{ isObjectSpace ? m_pVertexKernels->pTransformObjectSpace : m_pVertexKernels->pTransform };
+	if (m_State == RenderState::depth) pTransformKernel = m_pVertexKernels->pTransformPositions;
+	const int numBatches{ (numVertices + m_VertexBatchSize - 1) / m_VertexBatchSize };
+	m_pThreadPool->ParallelFor(numBatches, [&](int batchIndex)
+		{
+			const int begin{ batchIndex * m_VertexBatchSize };
+			const int end{ std::min(begin + m_VertexBatchSize, numVertices) };
+			pTransformKernel(setup, vertices_in, begin, end, vertices_out.data(), rasterVertices_out.data());
+		});
+}
+
+void SoftwareRenderer::VertexTransformationReference(std::span<const Vertex_PosTex> vertices_in, std::vector<Vertex_Out>& vertices_out, std::vector<Vertex_Raster>& rasterVertices_out, const Matrix& meshWorldMatrix) const
+{
+	vertices_out.resize(vertices_in.size());
+	rasterVertices_out.resize(vertices_in.size());
+
+	const Matrix worldViewProjectionMatrix = meshWorldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+
+	for (int i{}; i < vertices_in.size(); ++i)
+	{
+		//Clip space for the clipper, raster position, 1 / w and outcode once per vertex for setup
+		vertices_out[i].position = worldViewProjectionMatrix.TransformPoint(Vector4{ vertices_in[i].position, 1 });
+		rasterVertices_out[i] = ToRasterVertex(vertices_out[i].position);
+		vertices_out[i].uv = vertices_in[i].TexCoord;
+		vertices_out[i].normal = meshWorldMatrix.TransformVector(vertices_in[i].normal).Normalized(); //Normal and tangent in world space
+		vertices_out[i].tangent = meshWorldMatrix.TransformVector(vertices_in[i].tangent).Normalized();
+		vertices_out[i].viewDirection = (meshWorldMatrix.TransformPoint(vertices_in[i].position) - m_pCamera->origin).Normalized();
+	}
+}
+
+void SoftwareRenderer::RenderTriangleBoundingBox(uint32_t triangleIndex, int tileIndex, RasterStats& stats) const
+{
+	const Triangle& triangle{ m_Triangles[triangleIndex] };
+
+	//Only touch the pixels of this tile
+	int tileMinX{}, tileMinY{}, tileMaxX{}, tileMaxY{};
+	GetTileBounds(tileIndex, tileMinX, tileMinY, tileMaxX, tileMaxY);
+
+	const int minX{ std::max(triangle.minX, tileMinX) };
+	const int minY{ std::max(triangle.minY, tileMinY) };
+	const int maxX{ std::min(triangle.maxX, tileMaxX) };
+	const int maxY{ std::min(triangle.maxY, tileMaxY) };
+	++stats.testedTriangles;
+
+	const ColorRGB finalColor{ 1.f, 1.f, 1.f };
+	const Uint32 boundingBoxColor{ SDL_MapRGB(m_pBackBuffer->format,
+		static_cast<uint8_t>(finalColor.r * 255),
+		static_cast<uint8_t>(finalColor.g * 255),
+		static_cast<uint8_t>(finalColor.b * 255)) };
+
+	for (int py{ minY }; py < maxY; ++py)
+	{
+		for (int px{ minX }; px < maxX; ++px)
+		{
+			m_pColorBufferPixels[GetPixelIndex(px, py)] = boundingBoxColor;
+		}
+	}
+}
+
+template<SoftwareRenderer::RasterPass Pass, SoftwareRenderer::RenderState State, bool UsingNormalMap, Texture::Filter Filter, SoftwareRenderer::SpecularMode Specular, SoftwareRenderer::LightingSpace Space, SoftwareRenderer::NormalizeMode Normalize, bool UsingVisibilityBuffer>
+void SoftwareRenderer::RenderTriangle(uint32_t triangleIndex, int tileIndex, RasterStats& stats) const
+{
+	const Triangle& triangle{ m_Triangles[triangleIndex] };
+
+	//Only touch the pixels of this tile
+	int tileMinX{}, tileMinY{}, tileMaxX{}, tileMaxY{};
+	GetTileBounds(tileIndex, tileMinX, tileMinY, tileMaxX, tileMaxY);
+
+	const int minX{ std::max(triangle.minX, tileMinX) };
+	const int minY{ std::max(triangle.minY, tileMinY) };
+	const int maxX{ std::min(triangle.maxX, tileMaxX) };
+	const int maxY{ std::min(triangle.maxY, tileMaxY) };
+
+	//Nothing of the triangle can be in front of what the tile already holds
+	++stats.testedTriangles;
+	if (triangle.minZ > m_pHiZTiles[tileIndex])
+	{
+		++stats.rejectedTriangles;
+		return;
+	}
+
+	constexpr int blockWidth{ RasterKernels::BlockWidth };
+	static_assert(blockWidth == m_HiZBlockSize, "A kernel call covers one row of a depth block");
+
+	//Blocks are aligned to the block size, tiles are a multiple of it so a block never leaves its tile
+	const int firstBlockX{ minX & ~(blockWidth - 1) };
+	const int firstBlockY{ minY & ~(m_HiZBlockSize - 1) };
+
+	RasterKernels::BlockSetup blockSetup{};
+	blockSetup.invArea = triangle.invArea;
+	for (int i{}; i < 3; ++i)
+	{
+		blockSetup.fixedEdgeStepX[i] = triangle.fixedEdgeA[i] * m_SubPixelSteps;
+		blockSetup.edgeStepX[i] = triangle.edgeA[i];
+		blockSetup.z[i] = triangle.z[i];
+	}
+
+	//Edge values at the centre of the first block's first pixel, stepped with a per x and b per y from there
+	//The fixed point edges decide coverage exactly, the float edges only give the weights
+	int64_t fixedBlockRowEdge[3]{};
+	int64_t fixedBlockEdgeStep[3]{};
+	int64_t fixedRowEdgeStep[3]{};
+	float blockRowEdge[3]{};
+	float blockEdgeStep[3]{};
+	constexpr int32_t halfPixel{ m_SubPixelSteps / 2 };
+	for (int i{}; i < 3; ++i)
+	{
+		const int64_t fixedPixelX{ static_cast<int64_t>(firstBlockX) * m_SubPixelSteps + halfPixel - triangle.fixedEdgeOriginX[i] };
+		const int64_t fixedPixelY{ static_cast<int64_t>(minY) * m_SubPixelSteps + halfPixel - triangle.fixedEdgeOriginY[i] };
+		fixedBlockRowEdge[i] = triangle.fixedEdgeA[i] * fixedPixelX + triangle.fixedEdgeB[i] * fixedPixelY + triangle.fixedEdgeBias[i];
+		fixedBlockEdgeStep[i] = static_cast<int64_t>(triangle.fixedEdgeA[i]) * m_SubPixelSteps * blockWidth;
+		fixedRowEdgeStep[i] = static_cast<int64_t>(triangle.fixedEdgeB[i]) * m_SubPixelSteps;
+
+		blockRowEdge[i] = triangle.edgeA[i] * (firstBlockX + 0.5f - triangle.edgeOriginX[i]) + triangle.edgeB[i] * (minY + 0.5f - triangle.edgeOriginY[i]);
+		blockEdgeStep[i] = triangle.edgeA[i] * blockWidth;
+	}
+
+	RasterKernels::BlockResult blockResult{};
+	ShadingBlock shadingBlock{};
+	bool isTileDepthChanged{ false };
+
+	//The equal pass after a depth prepass never writes depth, so the HiZ values stay valid
+	const RasterKernels::CoverageDepthKernel pCoverageDepthKernel{ Pass == RasterPass::colorEqual ? m_pRasterKernels->pCoverageDepthEqual : m_pRasterKernels->pCoverageDepth };
+
+	for (int blockY{ firstBlockY }; blockY < maxY; blockY += m_HiZBlockSize)
+	{
+		const int blockMinY{ std::max(blockY, minY) };
+		const int blockMaxY{ std::min(blockY + m_HiZBlockSize, maxY) };
+
+		int64_t fixedBlockEdge[3]{ fixedBlockRowEdge[0], fixedBlockRowEdge[1], fixedBlockRowEdge[2] };
+		float blockEdge[3]{ blockRowEdge[0], blockRowEdge[1], blockRowEdge[2] };
+
+		for (int blockX{ firstBlockX }; blockX < maxX; blockX += blockWidth)
+		{
+			int64_t fixedRowEdge[3]{ fixedBlockEdge[0], fixedBlockEdge[1], fixedBlockEdge[2] };
+			float rowEdge[3]{ blockEdge[0], blockEdge[1], blockEdge[2] };
+			for (int i{}; i < 3; ++i)
+			{
+				fixedBlockEdge[i] += fixedBlockEdgeStep[i];
+				blockEdge[i] += blockEdgeStep[i];
+			}
+
+			//Coarse depth test for the whole 8x8 block
+			++stats.testedBlocks;
+			float& blockMaxDepth{ m_pHiZBlocks[blockX / m_HiZBlockSize + (blockY / m_HiZBlockSize) * m_NumHiZBlocksX] };
+			if (triangle.minZ > blockMaxDepth)
+			{
+				++stats.rejectedBlocks;
+				continue;
+			}
+
+			//Lanes inside the bounding box
+			const int firstLane{ std::max(minX - blockX, 0) };
+			const int lastLane{ std::min(maxX - blockX, blockWidth) };
+			const uint32_t laneMask{ ((1u << lastLane) - 1) & ~((1u << firstLane) - 1) };
+
+			bool isBlockDepthChanged{ false };
+
+			for (int py{ blockMinY }; py < blockMaxY; ++py)
+			{
+				for (int i{}; i < 3; ++i)
+				{
+					//Far away from the edge all lanes have the same sign, clamping keeps the lanes in 32 bit
+					blockSetup.fixedEdge[i] = static_cast<int32_t>(std::clamp(fixedRowEdge[i], -RasterKernels::MaxFixedEdge, RasterKernels::MaxFixedEdge));
+					fixedRowEdge[i] += fixedRowEdgeStep[i];
+
+					blockSetup.edge[i] = rowEdge[i];
+					rowEdge[i] += triangle.edgeB[i];
+				}
+
+				//The buffers are padded to whole blocks, so the SIMD kernels can access all lanes of a block row
+				float* pDepthRow{ m_pDepthBufferPixels + GetPixelIndex(blockX, py) };
+				if constexpr (Pass == RasterPass::depthOnly)
+				{
+					//Like the colour pass this writes the depth of fragments whose uv fails the range check, there is no uv here to reject them
+					if (m_pRasterKernels->pDepthOnly(blockSetup, laneMask, pDepthRow) != 0) isBlockDepthChanged = true;
+				}
+				else
+				{
+					const uint32_t passMask{ pCoverageDepthKernel(blockSetup, laneMask, pDepthRow, blockResult) };
+					if (passMask != 0 && Pass == RasterPass::color) isBlockDepthChanged = true;
+
+					//Shade the lanes that survived coverage and depth together, or only remember them for the visibility buffer
+					uint32_t shadeMask{};
+					for (uint32_t remainingMask{ passMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
+					{
+						const int lane{ std::countr_zero(remainingMask) };
+
+						const float weight0{ blockResult.weight[0][lane] };
+						const float weight1{ blockResult.weight[1][lane] };
+						const float weight2{ blockResult.weight[2][lane] };
+
+						float interpolatedWDepth{};
+						Vector2 interpolatedUV{};
+						if (!InterpolateUV(triangle, weight0, weight1, weight2, interpolatedWDepth, interpolatedUV))
+						{
+							continue;
+						}
+
+						++stats.shadedFragments;
+						if constexpr (UsingVisibilityBuffer)
+						{
+							m_pVisibilityBuffer[GetPixelIndex(blockX + lane, py)] = VisibilitySample{ triangleIndex, { weight0, weight1, weight2 }, blockResult.depth[lane] };
+						}
+						else
+						{
+							InterpolatePixel<State, UsingNormalMap, Space, Normalize>(triangle, weight0, weight1, weight2, interpolatedWDepth, interpolatedUV, lane, shadingBlock);
+							shadeMask |= 1u << lane;
+						}
+					}
+
+					if constexpr (!UsingVisibilityBuffer)
+					{
+						if (shadeMask != 0) ShadeBlock<State, UsingNormalMap, Filter, Specular, Space, Normalize>(shadingBlock, shadeMask, blockX, py);
+					}
+				}
+			}
+
+			//Depth only gets closer, so the block max is recomputed from the pixels instead of guessed
+			if (isBlockDepthChanged)
+			{
+				blockMaxDepth = ComputeBlockMaxDepth(blockX, blockY);
+				isTileDepthChanged = true;
+			}
+		}
+
+		for (int i{}; i < 3; ++i)
+		{
+			fixedBlockRowEdge[i] += fixedRowEdgeStep[i] * (blockMaxY - blockMinY);
+			blockRowEdge[i] += triangle.edgeB[i] * (blockMaxY - blockMinY);
+		}
+	}
+
+	if (isTileDepthChanged)
+	{
+		m_pHiZTiles[tileIndex] = ComputeTileMaxDepth(tileIndex);
+	}
+}
+
+bool SoftwareRenderer::InterpolateUV(const Triangle& triangle, float weight0, float weight1, float weight2, float& interpolatedWDepth, Vector2& interpolatedUV) const
+{
+	interpolatedWDepth = 1.f /
+			(
+			triangle.invW[0] * weight0 +
+			triangle.invW[1] * weight1 +
+			triangle.invW[2] * weight2
+			); //Quadratic-ish?
+
+	interpolatedUV = ((triangle.v0.uv * weight0) +
+						(triangle.v1.uv * weight1) +
+						(triangle.v2.uv * weight2))
+						* interpolatedWDepth;
+
+	if (interpolatedUV.x < 0 || interpolatedUV.y < 0)
+	{
+		return false;
+	}
+
+	if (interpolatedUV.x > 1 || interpolatedUV.y > 1)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+template<SoftwareRenderer::RenderState State, bool UsingNormalMap, SoftwareRenderer::LightingSpace Space, SoftwareRenderer::NormalizeMode Normalize>
+void SoftwareRenderer::InterpolatePixel(const Triangle& triangle, float weight0, float weight1, float weight2, float interpolatedWDepth, const Vector2& interpolatedUV, int lane, ShadingBlock& pixels) const
+{
+	const Vertex_Out& v0{ triangle.v0 };
+	const Vertex_Out& v1{ triangle.v1 };
+	const Vertex_Out& v2{ triangle.v2 };
+
+	pixels.uv.SetLane(lane, interpolatedUV);
+
+	//Only the attributes the render state reads get interpolated
+	//In object space a normal mapped pixel is normalized once, after the decoded normal is rotated, so its axes are left as they are
+	//The fast normalization leaves everything to the block in PixelShading
+	constexpr bool normalizesAxes{ Normalize == NormalizeMode::exact && (Space == LightingSpace::world || !UsingNormalMap) };
+	if constexpr (UsesNormal(State))
+	{
+		const Vector3 normal{ ((v0.normal * weight0) +
+							  (v1.normal * weight1) +
+							  (v2.normal * weight2))
+							  * interpolatedWDepth };
+		pixels.normal.SetLane(lane, normalizesAxes ? normal.Normalized() : normal);
+	}
+
+	if constexpr (UsesNormal(State) && UsingNormalMap)
+	{
+		const Vector3 tangent{ ((v0.tangent * weight0) +
+							   (v1.tangent * weight1) +
+							   (v2.tangent * weight2))
+							   * interpolatedWDepth };
+		pixels.tangent.SetLane(lane, normalizesAxes ? tangent.Normalized() : tangent);
+	}
+
+	if constexpr (UsesNormal(State) && UsingNormalMap && Space == LightingSpace::object)
+	{
+		pixels.binormal.SetLane(lane, ((v0.binormal * weight0) +
+									  (v1.binormal * weight1) +
+									  (v2.binormal * weight2))
+									  * interpolatedWDepth);
+	}
+
+	if constexpr (UsesViewDirection(State))
+	{
+		const Vector3 viewDirection{ ((v0.viewDirection * weight0) +
+									 (v1.viewDirection * weight1) +
+									 (v2.viewDirection * weight2))
+									 * interpolatedWDepth };
+		//Only used in the Phong dot product and within a hair of unit length over a triangle, so the fast mode skips normalizing it
+		pixels.viewDirection.SetLane(lane, Normalize == NormalizeMode::exact ? viewDirection.Normalized() : viewDirection);
+	}
+
+	//uv = (uv / w) * w, both parts change linearly over the screen so the quotient rule gives the derivatives
+	if constexpr (UsesTextures(State, UsingNormalMap))
+	{
+		pixels.dudx[lane] = (triangle.uOverWGradient[0] - interpolatedUV.x * triangle.invWGradient[0]) * interpolatedWDepth;
+		pixels.dvdx[lane] = (triangle.vOverWGradient[0] - interpolatedUV.y * triangle.invWGradient[0]) * interpolatedWDepth;
+		pixels.dudy[lane] = (triangle.uOverWGradient[1] - interpolatedUV.x * triangle.invWGradient[1]) * interpolatedWDepth;
+		pixels.dvdy[lane] = (triangle.vOverWGradient[1] - interpolatedUV.y * triangle.invWGradient[1]) * interpolatedWDepth;
+	}
+}
+
+template<SoftwareRenderer::RenderState State, bool UsingNormalMap, Texture::Filter Filter, SoftwareRenderer::SpecularMode Specular, SoftwareRenderer::LightingSpace Space, SoftwareRenderer::NormalizeMode Normalize>
+void SoftwareRenderer::ShadeBlock(const ShadingBlock& pixels, uint32_t laneMask, int blockX, int py) const
+{
+	BlockColors finalColors = PixelShading<State, UsingNormalMap, Filter, Specular, Space, Normalize>(pixels, laneMask);
+
+	finalColors.MaxToOne();
+
+	for (uint32_t remainingMask{ laneMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
+	{
+		const int lane{ std::countr_zero(remainingMask) };
+		const ColorRGB finalColor{ finalColors.GetLane(lane) };
+
+		m_pColorBufferPixels[GetPixelIndex(blockX + lane, py)] = SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(finalColor.r * 255),
+			static_cast<uint8_t>(finalColor.g * 255),
+			static_cast<uint8_t>(finalColor.b * 255));
+	}
+}
+
+bool SoftwareRenderer::SaveBufferToImage() const
+{
+	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+}
+
+void SoftwareRenderer::RenderMesh()
+{
+	if (m_ShouldUseUniformColor)
+	{
+		ColorRGB clearColor{ m_UniformColor.r * 255, m_UniformColor.g * 255 ,m_UniformColor.b * 255 };
+		m_ClearColorPacked = 0xFF000000 | (Uint32)clearColor.r | (Uint32)clearColor.g << 8 | (Uint32)clearColor.b << 16;
+	}
+	else
+	{
+		m_ClearColorPacked = 0xFF000000 | (Uint32)m_ClearColor.r | (Uint32)m_ClearColor.g << 8 | (Uint32)m_ClearColor.b << 16;
+	}
+
+	//RENDER LOGIC
+
+	//convert to screen space
+	VertexTransformationFunction(m_pMesh->GetVertexStreams(), m_pMesh->m_Vertices_out, m_pMesh->m_VerticesRaster_out, m_pMesh->m_WorldMatrix);
+
+	//Primitive assembly
+	m_Triangles.clear();
+	m_CullStats = {};
+
+	//Vertices are referenced by index, clipping appends its new vertices behind the mesh's
+	const std::span<const uint32_t> indices{ m_pMesh->GetIndices() };
+
+	if (m_pMesh->m_topology == PrimitiveTopology::TriangleList)
+	{
+		for (size_t i{}; i < indices.size() / 3; ++i)
+		{
+			AssembleTriangle(indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2]);
+		}
+	}
+	else
+	{
+		for (size_t i{}; i < indices.size() - 2; ++i)
+		{
+			if (i % 2 != 0)
+			{
+				AssembleTriangle(indices[i], indices[i + 2], indices[i + 1]);
+			}
+			else
+			{
+				AssembleTriangle(indices[i], indices[i + 1], indices[i + 2]);
+			}
+		}
+	}
+
+	BinTriangles();
+
+	//The state can't change during a draw, so its kernels are picked once here
+	const DrawKernels& drawKernels{ SelectDrawKernels(GetPipelineKey()) };
+
+	//Rasterize all tiles in parallel, a tile keeps the submission order of its triangles
+	m_pThreadPool->ParallelFor(m_NumTilesX * m_NumTilesY, [this, &drawKernels](int tileIndex)
+		{
+			RenderTile(tileIndex, drawKernels, m_TileStats[tileIndex]);
+		});
+}
+
+uint32_t SoftwareRenderer::GetPipelineKey() const
+{
+	uint32_t pipelineKey{ static_cast<uint32_t>(m_State) };
+	if (m_UsingNormalMap) pipelineKey |= m_PipelineNormalMapBit;
+	if (m_UsingVisibilityBuffer) pipelineKey |= m_PipelineVisibilityBufferBit;
+	if (m_UsingDepthPrepass) pipelineKey |= m_PipelineDepthPrepassBit;
+	pipelineKey |= static_cast<uint32_t>(m_SampleFilter) << m_PipelineFilterShift;
+	if (m_SpecularMode == SpecularMode::fastPow) pipelineKey |= m_PipelineFastSpecularBit;
+	if (UsesObjectSpaceLighting()) pipelineKey |= m_PipelineObjectSpaceBit;
+	if (m_NormalizeMode == NormalizeMode::fastRSqrt) pipelineKey |= m_PipelineFastNormalizeBit;
+	return pipelineKey;
+}
+
+template<uint32_t PipelineKey>
+constexpr SoftwareRenderer::DrawKernels SoftwareRenderer::CreateDrawKernels()
+{
+	constexpr RenderState state{ static_cast<RenderState>(PipelineKey & m_PipelineStateMask) };
+	constexpr bool usingNormalMap{ (PipelineKey & m_PipelineNormalMapBit) != 0 };
+	constexpr bool usingVisibilityBuffer{ (PipelineKey & m_PipelineVisibilityBufferBit) != 0 };
+	constexpr bool usingDepthPrepass{ (PipelineKey & m_PipelineDepthPrepassBit) != 0 };
+	constexpr uint32_t filterBits{ (PipelineKey & m_PipelineFilterMask) >> m_PipelineFilterShift };
+	//States that sample no texture all share the point filter instantiation
+	constexpr Texture::Filter filter{ UsesTextures(state, usingNormalMap) && filterBits <= static_cast<uint32_t>(Texture::Filter::trilinear) ? static_cast<Texture::Filter>(filterBits) : Texture::Filter::point };
+	//Likewise states without a specular term share the exact one
+	constexpr SpecularMode specular{ UsesViewDirection(state) && (PipelineKey & m_PipelineFastSpecularBit) != 0 ? SpecularMode::fastPow : SpecularMode::exact };
+	//And states that don't light a normal the world space one and the exact normalization
+	constexpr LightingSpace space{ UsesNormal(state) && (PipelineKey & m_PipelineObjectSpaceBit) != 0 ? LightingSpace::object : LightingSpace::world };
+	constexpr NormalizeMode normalize{ UsesNormal(state) && (PipelineKey & m_PipelineFastNormalizeBit) != 0 ? NormalizeMode::fastRSqrt : NormalizeMode::exact };
+
+	if constexpr (state == RenderState::boundingBox)
+	{
+		return DrawKernels{ nullptr, &SoftwareRenderer::RenderTriangleBoundingBox, nullptr };
+	}
+	else if constexpr (state == RenderState::depth)
+	{
+		//The depth view only needs the nearest depth, which the depth only pass already leaves in the depth buffer
+		//The depth only pass doesn't depend on the state, so all keys share one instantiation of it
+		return DrawKernels{ &SoftwareRenderer::RenderTriangle<RasterPass::depthOnly, RenderState::depth, false, Texture::Filter::point, SpecularMode::exact, LightingSpace::world, NormalizeMode::exact, false>, nullptr, &SoftwareRenderer::ShadeDepthTile };
+	}
+	else if constexpr (state > RenderState::boundingBox || filterBits > static_cast<uint32_t>(Texture::Filter::trilinear))
+	{
+		//Unused state or filter bits
+		return DrawKernels{};
+	}
+	else
+	{
+		//With a visibility buffer the raster pass doesn't shade, only the resolve depends on the state
+		constexpr RenderState rasterState{ usingVisibilityBuffer ? RenderState::combined : state };
+		constexpr bool rasterNormalMap{ usingNormalMap && !usingVisibilityBuffer };
+		constexpr SpecularMode rasterSpecular{ usingVisibilityBuffer ? SpecularMode::exact : specular };
+		constexpr LightingSpace rasterSpace{ usingVisibilityBuffer ? LightingSpace::world : space };
+		constexpr NormalizeMode rasterNormalize{ usingVisibilityBuffer ? NormalizeMode::exact : normalize };
+		//After a depth prepass only the fragments that end up visible get shaded
+		constexpr RasterPass colorPass{ usingDepthPrepass ? RasterPass::colorEqual : RasterPass::color };
+
+		DrawKernels drawKernels{};
+		if constexpr (usingDepthPrepass) drawKernels.pDepthPass = &SoftwareRenderer::RenderTriangle<RasterPass::depthOnly, RenderState::depth, false, Texture::Filter::point, SpecularMode::exact, LightingSpace::world, NormalizeMode::exact, false>;
+		drawKernels.pColorPass = &SoftwareRenderer::RenderTriangle<colorPass, rasterState, rasterNormalMap, usingVisibilityBuffer ? Texture::Filter::point : filter, rasterSpecular, rasterSpace, rasterNormalize, usingVisibilityBuffer>;
+		if constexpr (usingVisibilityBuffer) drawKernels.pResolveTile = &SoftwareRenderer::ResolveVisibilityTile<state, usingNormalMap, filter, specular, space, normalize>;
+		return drawKernels;
+	}
+}
+
+const SoftwareRenderer::DrawKernels& SoftwareRenderer::SelectDrawKernels(uint32_t pipelineKey)
+{
+	//One entry per key, every entry is instantiated at compile time
+	static constexpr std::array<DrawKernels, m_NumPipelineKeys> drawKernels{ []<uint32_t... PipelineKeys>(std::integer_sequence<uint32_t, PipelineKeys...>)
+		{
+			return std::array<DrawKernels, m_NumPipelineKeys>{ CreateDrawKernels<PipelineKeys>()... };
+		}(std::make_integer_sequence<uint32_t, m_NumPipelineKeys>{}) };
+
+	return drawKernels[pipelineKey];
+}
+
+Vertex_Raster SoftwareRenderer::ToRasterVertex(const Vector4& clipPosition) const
+{
+	return VertexKernels::ToRasterVertex(clipPosition, static_cast<float>(m_Width), static_cast<float>(m_Height));
+}
+
+Vertex_Raster SoftwareRenderer::ToClippedRasterVertex(const Vector4& clipPosition) const
+{
+	return VertexKernels::ToClippedRasterVertex(clipPosition, static_cast<float>(m_Width), static_cast<float>(m_Height));
+}
+
+void SoftwareRenderer::AssembleTriangle(uint32_t index0, uint32_t index1, uint32_t index2)
+{
+	const std::vector<Vertex_Raster>& rasterVertices{ m_pMesh->m_VerticesRaster_out };
+	const uint32_t outcode0{ rasterVertices[index0].outcode };
+	const uint32_t outcode1{ rasterVertices[index1].outcode };
+	const uint32_t outcode2{ rasterVertices[index2].outcode };
+
+	//All vertices outside of the same plane
+	if ((outcode0 & outcode1 & outcode2) != 0) return;
+
+	//Crossing the screen edges is fine, the bounding box gets clamped
+	//Only the near plane and the guard band need actual clipping, which is rare
+	const uint32_t clipPlanes{ (outcode0 | outcode1 | outcode2) & m_ClipPlanesMask };
+	if (clipPlanes == 0)
+	{
+		SetupTriangle(index0, index1, index2);
+		return;
+	}
+
+	ClipTriangle(index0, index1, index2, clipPlanes);
+}
+
+float SoftwareRenderer::GetClipDistance(const Vector4& position, uint32_t plane) const
+{
+	switch (plane)
+	{
+	case m_ClipNear:
+		return position.z;
+	case m_ClipGuardLeft:
+		return m_GuardBand * position.w + position.x;
+	case m_ClipGuardRight:
+		return m_GuardBand * position.w - position.x;
+	case m_ClipGuardBottom:
+		return m_GuardBand * position.w + position.y;
+	case m_ClipGuardTop:
+	default:
+		return m_GuardBand * position.w - position.y;
+	}
+}
+
+static Vertex_Out LerpVertex(const Vertex_Out& from, const Vertex_Out& to, float factor)
+{
+	Vertex_Out vertex{};
+	vertex.position = from.position + (to.position - from.position) * factor;
+	vertex.uv = from.uv + (to.uv - from.uv) * factor;
+	vertex.normal = from.normal + (to.normal - from.normal) * factor;
+	vertex.tangent = from.tangent + (to.tangent - from.tangent) * factor;
+	vertex.binormal = from.binormal + (to.binormal - from.binormal) * factor;
+	vertex.viewDirection = from.viewDirection + (to.viewDirection - from.viewDirection) * factor;
+	return vertex;
+}
+
+void SoftwareRenderer::ClipTriangle(uint32_t index0, uint32_t index1, uint32_t index2, uint32_t clipPlanes)
+{
+	//Polygon vertices remember where they came from, new ones get added to the frame's vertices afterwards
+	struct ClipVertex
+	{
+		Vertex_Out vertex;
+		uint32_t index;
+	};
+	constexpr uint32_t newVertex{ UINT32_MAX };
+
+	std::vector<Vertex_Out>& vertices{ m_pMesh->m_Vertices_out };
+	std::vector<Vertex_Raster>& rasterVertices{ m_pMesh->m_VerticesRaster_out };
+
+	//Sutherland-Hodgman in clip space, every plane adds at most one vertex
+	constexpr int maxVertices{ 3 + 5 };
+	ClipVertex polygons[2][maxVertices]{};
+	int numVertices{ 3 };
+	polygons[0][0] = ClipVertex{ vertices[index0], index0 };
+	polygons[0][1] = ClipVertex{ vertices[index1], index1 };
+	polygons[0][2] = ClipVertex{ vertices[index2], index2 };
+
+	int current{ 0 };
+	for (uint32_t remainingPlanes{ clipPlanes }; remainingPlanes != 0; remainingPlanes &= remainingPlanes - 1)
+	{
+		const uint32_t plane{ remainingPlanes & (~remainingPlanes + 1) };
+
+		const ClipVertex* pInput{ polygons[current] };
+		ClipVertex* pOutput{ polygons[1 - current] };
+		int numOutput{ 0 };
+
+		for (int i{}; i < numVertices; ++i)
+		{
+			const ClipVertex& from{ pInput[i] };
+			const ClipVertex& to{ pInput[(i + 1) % numVertices] };
+			const float fromDistance{ GetClipDistance(from.vertex.position, plane) };
+			const float toDistance{ GetClipDistance(to.vertex.position, plane) };
+
+			if (fromDistance >= 0)
+			{
+				pOutput[numOutput++] = from;
+			}
+			if ((fromDistance >= 0) != (toDistance >= 0))
+			{
+				pOutput[numOutput++] = ClipVertex{ LerpVertex(from.vertex, to.vertex, fromDistance / (fromDistance - toDistance)), newVertex };
+			}
+		}
+
+		numVertices = numOutput;
+		current = 1 - current;
+		if (numVertices < 3) return;
+	}
+
+	ClipVertex* pPolygon{ polygons[current] };
+	for (int i{}; i < numVertices; ++i)
+	{
+		if (pPolygon[i].index != newVertex) continue;
+
+		pPolygon[i].index = static_cast<uint32_t>(vertices.size());
+		vertices.push_back(pPolygon[i].vertex);
+		rasterVertices.push_back(ToClippedRasterVertex(pPolygon[i].vertex.position));
+	}
+
+	//Fan, keeps the winding of the original triangle
+	for (int i{ 1 }; i < numVertices - 1; ++i)
+	{
+		SetupTriangle(pPolygon[0].index, pPolygon[i].index, pPolygon[i + 1].index);
+	}
+}
+
+void SoftwareRenderer::SetupTriangle(uint32_t index0, uint32_t index1, uint32_t index2)
+{
+	const std::vector<Vertex_Raster>& rasterVertices{ m_pMesh->m_VerticesRaster_out };
+
+	//Cull on the signed area once instead of testing the winding for every pixel
+	//Positive area is front facing, back facing triangles that are kept get flipped so the kernel only has to test for positive edges
+	const Vertex_Raster* pRasterVertices[3]{ &rasterVertices[index0], &rasterVertices[index1], &rasterVertices[index2] };
+	int64_t fixedArea{ static_cast<int64_t>(pRasterVertices[1]->fixedX - pRasterVertices[0]->fixedX) * (pRasterVertices[2]->fixedY - pRasterVertices[0]->fixedY)
+		- static_cast<int64_t>(pRasterVertices[1]->fixedY - pRasterVertices[0]->fixedY) * (pRasterVertices[2]->fixedX - pRasterVertices[0]->fixedX) };
+
+	if (fixedArea == 0)
+	{
+		++m_CullStats.degenerate;
+		return;
+	}
+
+	if (fixedArea < 0)
+	{
+		if (m_CullMode == CullingMode::back)
+		{
+			++m_CullStats.backFacing;
+			return;
+		}
+		std::swap(index1, index2);
+		std::swap(pRasterVertices[1], pRasterVertices[2]);
+		fixedArea = -fixedArea;
+	}
+	else if (m_CullMode == CullingMode::front)
+	{
+		++m_CullStats.frontFacing;
+		return;
+	}
+
+	int32_t fixedX[3]{};
+	int32_t fixedY[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		fixedX[i] = pRasterVertices[i]->fixedX;
+		fixedY[i] = pRasterVertices[i]->fixedY;
+	}
+
+	//Tight bounding box of the pixel centres inside the triangle's bounds, max is exclusive
+	//Centre of pixel p lies at p * 16 + 8 in fixed point
+	constexpr int32_t halfPixel{ m_SubPixelSteps / 2 };
+	const int32_t fixedMinX{ std::min(fixedX[0], std::min(fixedX[1], fixedX[2])) };
+	const int32_t fixedMinY{ std::min(fixedY[0], std::min(fixedY[1], fixedY[2])) };
+	const int32_t fixedMaxX{ std::max(fixedX[0], std::max(fixedX[1], fixedX[2])) };
+	const int32_t fixedMaxY{ std::max(fixedY[0], std::max(fixedY[1], fixedY[2])) };
+
+	const int minX{ (fixedMinX - halfPixel + m_SubPixelSteps - 1) >> m_SubPixelBits };
+	const int minY{ (fixedMinY - halfPixel + m_SubPixelSteps - 1) >> m_SubPixelBits };
+	const int maxX{ ((fixedMaxX - halfPixel) >> m_SubPixelBits) + 1 };
+	const int maxY{ ((fixedMaxY - halfPixel) >> m_SubPixelBits) + 1 };
+
+	//No pixel centre in between the vertices
+	if (minX >= maxX || minY >= maxY)
+	{
+		++m_CullStats.subPixel;
+		return;
+	}
+
+	//Triangle setup
+	Triangle triangle{};
+
+	//Inside the guard band the triangle can stick out of the screen, so this is where it gets cut to the screen
+	triangle.minX = Clamp(minX, 0, m_Width);
+	triangle.minY = Clamp(minY, 0, m_Height);
+	triangle.maxX = Clamp(maxX, 0, m_Width);
+	triangle.maxY = Clamp(maxY, 0, m_Height);
+	if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) return;
+
+	for (int i{}; i < 3; ++i)
+	{
+		//Edge from the next to the previous vertex: E = Cross(to - from, pixel - from)
+		const int from{ (i + 1) % 3 };
+		const int to{ (i + 2) % 3 };
+
+		triangle.fixedEdgeA[i] = fixedY[from] - fixedY[to];
+		triangle.fixedEdgeB[i] = fixedX[to] - fixedX[from];
+		triangle.fixedEdgeOriginX[i] = fixedX[from];
+		triangle.fixedEdgeOriginY[i] = fixedY[from];
+
+		//Top-left rule: pixel centres exactly on an edge only belong to the triangle for top and left edges
+		//With y pointing down and the inside on the positive side, a left edge has a > 0 and a top edge is horizontal with b > 0
+		const bool isTopLeft{ triangle.fixedEdgeA[i] > 0 || (triangle.fixedEdgeA[i] == 0 && triangle.fixedEdgeB[i] > 0) };
+		triangle.fixedEdgeBias[i] = isTopLeft ? 0 : -1;
+
+		//The snapped positions are exact in float
+		triangle.edgeA[i] = static_cast<float>(triangle.fixedEdgeA[i]) / m_SubPixelSteps;
+		triangle.edgeB[i] = static_cast<float>(triangle.fixedEdgeB[i]) / m_SubPixelSteps;
+		triangle.edgeOriginX[i] = static_cast<float>(fixedX[from]) / m_SubPixelSteps;
+		triangle.edgeOriginY[i] = static_cast<float>(fixedY[from]) / m_SubPixelSteps;
+
+		triangle.z[i] = pRasterVertices[i]->z;
+		triangle.invW[i] = pRasterVertices[i]->invW;
+	}
+
+	triangle.invArea = static_cast<float>(m_SubPixelSteps * m_SubPixelSteps) / static_cast<float>(fixedArea);
+
+	triangle.minZ = std::min(triangle.z[0], std::min(triangle.z[1], triangle.z[2]));
+
+	//Attributes over w, the pixel loop multiplies them back with the interpolated w
+	const std::vector<Vertex_Out>& vertices{ m_pMesh->m_Vertices_out };
+	const uint32_t indices[3]{ index0, index1, index2 };
+	Vertex_Out* pSetupVertices[3]{ &triangle.v0, &triangle.v1, &triangle.v2 };
+	for (int i{}; i < 3; ++i)
+	{
+		const Vertex_Out& vertex{ vertices[indices[i]] };
+		Vertex_Out& setupVertex{ *pSetupVertices[i] };
+		setupVertex.position = Vector4{ static_cast<float>(fixedX[i]) / m_SubPixelSteps, static_cast<float>(fixedY[i]) / m_SubPixelSteps, triangle.z[i], vertex.position.w };
+		setupVertex.uv = vertex.uv * triangle.invW[i];
+		setupVertex.normal = vertex.normal * triangle.invW[i];
+		setupVertex.tangent = vertex.tangent * triangle.invW[i];
+		setupVertex.binormal = vertex.binormal * triangle.invW[i];
+		setupVertex.viewDirection = vertex.viewDirection * triangle.invW[i];
+
+		//Weight i changes by a * invArea per pixel in x and by b * invArea in y
+		const float weightGradient[2]{ triangle.edgeA[i] * triangle.invArea, triangle.edgeB[i] * triangle.invArea };
+		for (int axis{}; axis < 2; ++axis)
+		{
+			triangle.uOverWGradient[axis] += setupVertex.uv.x * weightGradient[axis];
+			triangle.vOverWGradient[axis] += setupVertex.uv.y * weightGradient[axis];
+			triangle.invWGradient[axis] += triangle.invW[i] * weightGradient[axis];
+		}
+	}
+
+	m_Triangles.push_back(triangle);
+}
+
+void SoftwareRenderer::BinTriangles()
+{
+	for (std::vector<uint32_t>& bin : m_TileBins)
+	{
+		bin.clear();
+	}
+
+	for (uint32_t i{}; i < m_Triangles.size(); ++i)
+	{
+		const Triangle& triangle{ m_Triangles[i] };
+
+		const int firstTileX{ triangle.minX / m_TileSize };
+		const int firstTileY{ triangle.minY / m_TileSize };
+		const int lastTileX{ (triangle.maxX - 1) / m_TileSize };
+		const int lastTileY{ (triangle.maxY - 1) / m_TileSize };
+
+		for (int tileY{ firstTileY }; tileY <= lastTileY; ++tileY)
+		{
+			for (int tileX{ firstTileX }; tileX <= lastTileX; ++tileX)
+			{
+				m_TileBins[tileX + tileY * m_NumTilesX].push_back(i);
+			}
+		}
+	}
+}
+
+void SoftwareRenderer::RenderTile(int tileIndex, const DrawKernels& drawKernels, RasterStats& stats) const
+{
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetTileBounds(tileIndex, minX, minY, maxX, maxY);
+
+	//Clear this tile's part of the buffers, in the blocked layout every row of blocks is one run
+	if (m_BufferLayout == BufferLayout::blocked)
+	{
+		const int runLength{ ((maxX - minX + m_HiZBlockSize - 1) / m_HiZBlockSize) * m_HiZBlockSize * m_HiZBlockSize };
+		for (int blockY{ minY }; blockY < maxY; blockY += m_HiZBlockSize)
+		{
+			const int firstPixel{ GetPixelIndex(minX, blockY) };
+			std::fill_n(m_pColorBufferPixels + firstPixel, runLength, m_ClearColorPacked);
+			std::fill_n(m_pDepthBufferPixels + firstPixel, runLength, FLT_MAX);
+			if (m_UsingVisibilityBuffer) std::fill_n(m_pVisibilityBuffer + firstPixel, runLength, m_EmptyVisibilitySample);
+		}
+	}
+	else
+	{
+		for (int py{ minY }; py < maxY; ++py)
+		{
+			const int firstPixel{ GetPixelIndex(minX, py) };
+			std::fill_n(m_pColorBufferPixels + firstPixel, maxX - minX, m_ClearColorPacked);
+			std::fill_n(m_pDepthBufferPixels + firstPixel, maxX - minX, FLT_MAX);
+			if (m_UsingVisibilityBuffer) std::fill_n(m_pVisibilityBuffer + firstPixel, maxX - minX, m_EmptyVisibilitySample);
+		}
+	}
+
+	const int firstBlockX{ minX / m_HiZBlockSize };
+	const int lastBlockX{ (maxX - 1) / m_HiZBlockSize };
+	for (int blockY{ minY / m_HiZBlockSize }; blockY <= (maxY - 1) / m_HiZBlockSize; ++blockY)
+	{
+		std::fill(m_pHiZBlocks + firstBlockX + blockY * m_NumHiZBlocksX, m_pHiZBlocks + lastBlockX + 1 + blockY * m_NumHiZBlocksX, FLT_MAX);
+	}
+	m_pHiZTiles[tileIndex] = FLT_MAX;
+
+	stats = {};
+
+	//First the final depth of every pixel when there is a depth pass, then the colour pass
+	if (drawKernels.pDepthPass)
+	{
+		for (uint32_t triangleIndex : m_TileBins[tileIndex])
+		{
+			(this->*drawKernels.pDepthPass)(triangleIndex, tileIndex, stats);
+		}
+	}
+	if (drawKernels.pColorPass)
+	{
+		for (uint32_t triangleIndex : m_TileBins[tileIndex])
+		{
+			(this->*drawKernels.pColorPass)(triangleIndex, tileIndex, stats);
+		}
+	}
+
+	//Every triangle of the tile is rasterized, so what the visibility or depth buffer holds now is final
+	if (drawKernels.pResolveTile)
+	{
+		(this->*drawKernels.pResolveTile)(tileIndex);
+	}
+}
+
+template<SoftwareRenderer::RenderState State, bool UsingNormalMap, Texture::Filter Filter, SoftwareRenderer::SpecularMode Specular, SoftwareRenderer::LightingSpace Space, SoftwareRenderer::NormalizeMode Normalize>
+void SoftwareRenderer::ResolveVisibilityTile(int tileIndex) const
+{
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetTileBounds(tileIndex, minX, minY, maxX, maxY);
+
+	//The lanes of a block can belong to different triangles, each one is interpolated from its own
+	ShadingBlock shadingBlock{};
+	for (int py{ minY }; py < maxY; ++py)
+	{
+		for (int blockX{ minX }; blockX < maxX; blockX += m_ShadingWidth)
+		{
+			uint32_t shadeMask{};
+			const int numLanes{ std::min(maxX - blockX, m_ShadingWidth) };
+			for (int lane{}; lane < numLanes; ++lane)
+			{
+				const VisibilitySample& sample{ m_pVisibilityBuffer[GetPixelIndex(blockX + lane, py)] };
+				if (sample.triangleIndex == m_InvalidTriangleIndex) continue;
+
+				const Triangle& triangle{ m_Triangles[sample.triangleIndex] };
+
+				//Same interpolation as the raster pass, the uv was already checked there
+				float interpolatedWDepth{};
+				Vector2 interpolatedUV{};
+				InterpolateUV(triangle, sample.weight[0], sample.weight[1], sample.weight[2], interpolatedWDepth, interpolatedUV);
+
+				InterpolatePixel<State, UsingNormalMap, Space, Normalize>(triangle, sample.weight[0], sample.weight[1], sample.weight[2], interpolatedWDepth, interpolatedUV, lane, shadingBlock);
+				shadeMask |= 1u << lane;
+			}
+
+			if (shadeMask != 0) ShadeBlock<State, UsingNormalMap, Filter, Specular, Space, Normalize>(shadingBlock, shadeMask, blockX, py);
+		}
+	}
+}
+
+void SoftwareRenderer::ShadeDepthTile(int tileIndex) const
+{
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetTileBounds(tileIndex, minX, minY, maxX, maxY);
+
+	for (int py{ minY }; py < maxY; ++py)
+	{
+		for (int px{ minX }; px < maxX; ++px)
+		{
+			const int pixelIndex{ GetPixelIndex(px, py) };
+			const float depth{ m_pDepthBufferPixels[pixelIndex] };
+			//Unlike the old per fragment shading this also colours the pixels whose nearest fragment fails the uv range check
+			if (depth == FLT_MAX) continue;
+
+			//Remap the Z depth
+			const float depthRemap{ Remap(depth, 0.995f, 1.0f) };
+			ColorRGB finalColor{ depthRemap, depthRemap, depthRemap };
+			finalColor.MaxToOne();
+
+			m_pColorBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+				static_cast<uint8_t>(finalColor.r * 255),
+				static_cast<uint8_t>(finalColor.g * 255),
+				static_cast<uint8_t>(finalColor.b * 255));
+		}
+	}
+}
+
+float SoftwareRenderer::ComputeBlockMaxDepth(int blockX, int blockY) const
+{
+	const int maxX{ std::min(blockX + m_HiZBlockSize, m_Width) };
+	const int maxY{ std::min(blockY + m_HiZBlockSize, m_Height) };
+
+	float maxDepth{ 0.f };
+	for (int py{ blockY }; py < maxY; ++py)
+	{
+		const float* pDepthRow{ m_pDepthBufferPixels + GetPixelIndex(blockX, py) };
+		for (int lane{}; lane < maxX - blockX; ++lane)
+		{
+			maxDepth = std::max(maxDepth, pDepthRow[lane]);
+		}
+	}
+	return maxDepth;
+}
+
+float SoftwareRenderer::ComputeTileMaxDepth(int tileIndex) const
+{
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetTileBounds(tileIndex, minX, minY, maxX, maxY);
+
+	const int firstBlockX{ minX / m_HiZBlockSize };
+	const int lastBlockX{ (maxX - 1) / m_HiZBlockSize };
+
+	float maxDepth{ 0.f };
+	for (int blockY{ minY / m_HiZBlockSize }; blockY <= (maxY - 1) / m_HiZBlockSize; ++blockY)
+	{
+		for (int blockX{ firstBlockX }; blockX <= lastBlockX; ++blockX)
+		{
+			maxDepth = std::max(maxDepth, m_pHiZBlocks[blockX + blockY * m_NumHiZBlocksX]);
+		}
+	}
+	return maxDepth;
+}
+
+void SoftwareRenderer::GetTileBounds(int tileIndex, int& minX, int& minY, int& maxX, int& maxY) const
+{
+	minX = (tileIndex % m_NumTilesX) * m_TileSize;
+	minY = (tileIndex / m_NumTilesX) * m_TileSize;
+	maxX = std::min(minX + m_TileSize, m_Width);
+	maxY = std::min(minY + m_TileSize, m_Height);
+}
+
+void SoftwareRenderer::CreateBuffers(int width, int height)
+{
+	DeleteBuffers();
+
+	m_Width = width;
+	m_Height = height;
+
+	//Tiles
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+	m_TileBins.resize(m_NumTilesX * m_NumTilesY);
+	m_TileStats.resize(m_NumTilesX * m_NumTilesY);
+
+	//Hierarchical depth
+	m_NumHiZBlocksX = (m_Width + m_HiZBlockSize - 1) / m_HiZBlockSize;
+	m_NumHiZBlocksY = (m_Height + m_HiZBlockSize - 1) / m_HiZBlockSize;
+	m_pHiZBlocks = new float[m_NumHiZBlocksX * m_NumHiZBlocksY];
+	m_pHiZTiles = new float[m_NumTilesX * m_NumTilesY];
+
+	//Buffers, padded so every block is complete
+	m_BufferWidth = m_NumHiZBlocksX * m_HiZBlockSize;
+	m_BufferHeight = m_NumHiZBlocksY * m_HiZBlockSize;
+	m_pColorBufferPixels = new uint32_t[m_BufferWidth * m_BufferHeight]{};
+	m_pDepthBufferPixels = new float[m_BufferWidth * m_BufferHeight]{};
+	m_pVisibilityBuffer = new VisibilitySample[m_BufferWidth * m_BufferHeight]{};
+}
+
+void SoftwareRenderer::DeleteBuffers()
+{
+	delete[] m_pColorBufferPixels;
+	m_pColorBufferPixels = nullptr;
+	delete[] m_pDepthBufferPixels;
+	m_pDepthBufferPixels = nullptr;
+	delete[] m_pVisibilityBuffer;
+	m_pVisibilityBuffer = nullptr;
+	delete[] m_pHiZBlocks;
+	m_pHiZBlocks = nullptr;
+	delete[] m_pHiZTiles;
+	m_pHiZTiles = nullptr;
+}
+
+void SoftwareRenderer::ResolveColorBuffer(uint32_t* pPixels, int pitch) const
+{
+	//Every job converts one row of blocks
+	m_pThreadPool->ParallelFor(m_NumHiZBlocksY, [this, pPixels, pitch](int blockY)
+		{
+			const int minY{ blockY * m_HiZBlockSize };
+			const int maxY{ std::min(minY + m_HiZBlockSize, m_Height) };
+
+			for (int py{ minY }; py < maxY; ++py)
+			{
+				uint32_t* pRow{ pPixels + py * pitch };
+
+				if (m_BufferLayout == BufferLayout::linear)
+				{
+					std::copy_n(m_pColorBufferPixels + GetPixelIndex(0, py), m_Width, pRow);
+					continue;
+				}
+
+				for (int blockX{}; blockX < m_Width; blockX += m_HiZBlockSize)
+				{
+					std::copy_n(m_pColorBufferPixels + GetPixelIndex(blockX, py), std::min(m_HiZBlockSize, m_Width - blockX), pRow + blockX);
+				}
+			}
+		});
+}
+
+void SoftwareRenderer::SetThreadCount(int numThreads)
+{
+	m_pThreadPool->SetNumThreads(numThreads);
+}
+
+int SoftwareRenderer::GetThreadCount() const
+{
+	return m_pThreadPool->GetNumThreads();
+}
+
+void SoftwareRenderer::CompareRasterKernels()
+{
+	const RasterKernels::KernelSet* pSelectedKernels{ m_pRasterKernels };
+	const bool wasUsingDepthPrepass{ m_UsingDepthPrepass };
+	const int numPixels{ m_BufferWidth * m_BufferHeight };
+
+	std::cout << "**RASTER KERNEL COMPARISON** " << pSelectedKernels->name << " vs " << RasterKernels::GetScalarKernels().name << "\n";
+
+	SDL_LockSurface(m_pBackBuffer);
+	for (const bool usingDepthPrepass : { false, true })
+	{
+		m_UsingDepthPrepass = usingDepthPrepass;
+
+		//Reference frame with the scalar kernels
+		m_pRasterKernels = &RasterKernels::GetScalarKernels();
+		RenderMesh();
+		const std::vector<uint32_t> referenceColors(m_pColorBufferPixels, m_pColorBufferPixels + numPixels);
+		const std::vector<float> referenceDepths(m_pDepthBufferPixels, m_pDepthBufferPixels + numPixels);
+
+		m_pRasterKernels = pSelectedKernels;
+		RenderMesh();
+
+		int colorMismatches{};
+		int depthMismatches{};
+		for (int i{}; i < numPixels; ++i)
+		{
+			if (referenceColors[i] != m_pColorBufferPixels[i]) ++colorMismatches;
+			if (referenceDepths[i] != m_pDepthBufferPixels[i]) ++depthMismatches;
+		}
+
+		const char* passName{ usingDepthPrepass ? "DEPTH PREPASS" : "FORWARD" };
+		std::cout << ">> " << passName << " COLOR MISMATCHES = " << colorMismatches << std::endl;
+		std::cout << ">> " << passName << " DEPTH MISMATCHES = " << depthMismatches << std::endl;
+	}
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	m_UsingDepthPrepass = wasUsingDepthPrepass;
+}
+
+void SoftwareRenderer::CompareWideTypes(int numBlocks)
+{
+	std::mt19937 randomEngine{ 1234 };
+	std::uniform_real_distribution<float> randomValue{ -1.f, 1.f };
+	std::uniform_real_distribution<float> randomFactor{ 0.f, 1.f };
+	std::uniform_int_distribution<uint32_t> randomMask{ 0, BlockFloats::FullMask() };
+
+	//Exact comparisons, every lane has to round like the scalar operation
+	const auto vectorsDiffer = [](const Vector3& v1, const Vector3& v2) { return v1.x != v2.x || v1.y != v2.y || v1.z != v2.z; };
+	const auto colorsDiffer = [](const ColorRGB& c1, const ColorRGB& c2) { return c1.r != c2.r || c1.g != c2.g || c1.b != c2.b; };
+
+	int dotMismatches{};
+	int crossMismatches{};
+	int normalizeMismatches{};
+	int reflectMismatches{};
+	int saturateMismatches{};
+	int lerpMismatches{};
+	int selectMismatches{};
+
+	for (int block{}; block < numBlocks; ++block)
+	{
+		BlockVectors vectorsA;
+		BlockVectors vectorsB;
+		BlockColors colorsA;
+		BlockColors colorsB;
+		BlockFloats values;
+		BlockFloats factors;
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
+		{
+			vectorsA.SetLane(lane, Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) });
+			vectorsB.SetLane(lane, Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) });
+			colorsA.SetLane(lane, ColorRGB{ randomFactor(randomEngine), randomFactor(randomEngine), randomFactor(randomEngine) });
+			colorsB.SetLane(lane, ColorRGB{ randomFactor(randomEngine), randomFactor(randomEngine), randomFactor(randomEngine) });
+			//Twice the range, so Saturate clamps about half of the lanes
+			values[lane] = 2.f * randomValue(randomEngine);
+			factors[lane] = randomFactor(randomEngine);
+		}
+		const uint32_t laneMask{ randomMask(randomEngine) };
+
+		const BlockFloats dots{ BlockVectors::Dot(vectorsA, vectorsB) };
+		const BlockVectors crosses{ BlockVectors::Cross(vectorsA, vectorsB) };
+		const BlockVectors normalized{ vectorsA.Normalized() };
+		const BlockVectors reflected{ BlockVectors::Reflect(vectorsA, normalized) };
+		const BlockFloats saturated{ Saturate(values) };
+		const BlockFloats lerpedFloats{ Lerp(dots, values, factors) };
+		const BlockVectors lerpedVectors{ Lerp(vectorsA, vectorsB, factors) };
+		const BlockColors lerpedColors{ BlockColors::Lerp(colorsA, colorsB, factors) };
+		const BlockFloats selectedFloats{ Select(laneMask, values, factors) };
+		const BlockVectors selectedVectors{ Select(laneMask, vectorsA, vectorsB) };
+		const BlockColors selectedColors{ Select(laneMask, colorsA, colorsB) };
+
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
+		{
+			const Vector3 vectorA{ vectorsA.GetLane(lane) };
+			const Vector3 vectorB{ vectorsB.GetLane(lane) };
+			const ColorRGB colorA{ colorsA.GetLane(lane) };
+			const ColorRGB colorB{ colorsB.GetLane(lane) };
+			const bool isSelected{ ((laneMask >> lane) & 1) != 0 };
+
+			dotMismatches += dots[lane] != Vector3::Dot(vectorA, vectorB);
+			crossMismatches += vectorsDiffer(crosses.GetLane(lane), Vector3::Cross(vectorA, vectorB));
+			normalizeMismatches += vectorsDiffer(normalized.GetLane(lane), vectorA.Normalized());
+			reflectMismatches += vectorsDiffer(reflected.GetLane(lane), Vector3::Reflect(vectorA, vectorA.Normalized()));
+			saturateMismatches += saturated[lane] != Saturate(values[lane]);
+			lerpMismatches += lerpedFloats[lane] != Lerpf(dots[lane], values[lane], factors[lane])
+				|| vectorsDiffer(lerpedVectors.GetLane(lane), Vector3{ Lerpf(vectorA.x, vectorB.x, factors[lane]), Lerpf(vectorA.y, vectorB.y, factors[lane]), Lerpf(vectorA.z, vectorB.z, factors[lane]) })
+				|| colorsDiffer(lerpedColors.GetLane(lane), ColorRGB::Lerp(colorA, colorB, factors[lane]));
+			selectMismatches += selectedFloats[lane] != (isSelected ? values[lane] : factors[lane])
+				|| vectorsDiffer(selectedVectors.GetLane(lane), isSelected ? vectorA : vectorB)
+				|| colorsDiffer(selectedColors.GetLane(lane), isSelected ? colorA : colorB);
+		}
+	}
+
+	std::cout << "**WIDE TYPE COMPARISON** " << m_ShadingWidth << " lanes vs scalar, " << numBlocks * m_ShadingWidth << " lanes\n";
+	std::cout << ">> DOT MISMATCHES = " << dotMismatches << std::endl;
+	std::cout << ">> CROSS MISMATCHES = " << crossMismatches << std::endl;
+	std::cout << ">> NORMALIZE MISMATCHES = " << normalizeMismatches << std::endl;
+	std::cout << ">> REFLECT MISMATCHES = " << reflectMismatches << std::endl;
+	std::cout << ">> SATURATE MISMATCHES = " << saturateMismatches << std::endl;
+	std::cout << ">> LERP MISMATCHES = " << lerpMismatches << std::endl;
+	std::cout << ">> SELECT MISMATCHES = " << selectMismatches << std::endl;
+}
+
+void SoftwareRenderer::CompareDepthPrepass()
+{
+	const bool wasUsingDepthPrepass{ m_UsingDepthPrepass };
+	const RenderState originalState{ m_State };
+	const int numPixels{ m_BufferWidth * m_BufferHeight };
+
+	const auto countShadedFragments = [this]()
+	{
+		uint32_t shadedFragments{};
+		for (const RasterStats& stats : m_TileStats) shadedFragments += stats.shadedFragments;
+		return shadedFragments;
+	};
+
+	SDL_LockSurface(m_pBackBuffer);
+	m_State = RenderState::combined;
+
+	m_UsingDepthPrepass = false;
+	RenderMesh();
+	const std::vector<uint32_t> referenceColors(m_pColorBufferPixels, m_pColorBufferPixels + numPixels);
+	const uint32_t forwardFragments{ countShadedFragments() };
+
+	m_UsingDepthPrepass = true;
+	RenderMesh();
+	const uint32_t prepassFragments{ countShadedFragments() };
+
+	int colorMismatches{};
+	int coveredPixels{};
+	for (int i{}; i < numPixels; ++i)
+	{
+		if (referenceColors[i] != m_pColorBufferPixels[i]) ++colorMismatches;
+		if (m_pDepthBufferPixels[i] != FLT_MAX) ++coveredPixels;
+	}
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	m_State = originalState;
+	m_UsingDepthPrepass = wasUsingDepthPrepass;
+
+	std::cout << "**DEPTH PREPASS COMPARISON** combined state\n";
+	std::cout << ">> COVERED PIXELS = " << coveredPixels << std::endl;
+	std::cout << ">> FORWARD SHADED FRAGMENTS = " << forwardFragments << std::endl;
+	std::cout << ">> PREPASS SHADED FRAGMENTS = " << prepassFragments << std::endl;
+	std::cout << ">> COLOR MISMATCHES = " << colorMismatches << std::endl;
+}
+
+void SoftwareRenderer::CheckNearClipping()
+{
+	const Matrix originalWorldMatrix{ m_pMesh->m_WorldMatrix };
+
+	//Moved so the camera sits in the middle of the mesh, its triangles cross the near plane and the guard band on every side
+	m_pMesh->m_WorldMatrix = originalWorldMatrix * Matrix::CreateTranslation(m_pCamera->origin - originalWorldMatrix.GetTranslation());
+
+	SDL_LockSurface(m_pBackBuffer);
+	RenderMesh();
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	//The clipper appends its vertices behind the mesh's own
+	const std::vector<Vertex_Raster>& rasterVertices{ m_pMesh->m_VerticesRaster_out };
+	const size_t numMeshVertices{ m_pMesh->GetVertexStreams().positionX.size() };
+	int numMissing{};
+	for (size_t i{ numMeshVertices }; i < rasterVertices.size(); ++i)
+	{
+		if (rasterVertices[i].invW <= 0.f || (rasterVertices[i].outcode & m_ClipPlanesMask) != 0) ++numMissing;
+	}
+	const int numClipped{ static_cast<int>(rasterVertices.size() - numMeshVertices) };
+
+	m_pMesh->m_WorldMatrix = originalWorldMatrix;
+
+	std::cout << "**NEAR CLIPPING CHECK** camera inside the mesh " << (numClipped > 0 && numMissing == 0 ? "PASSED" : "FAILED") << "\n";
+	std::cout << ">> CLIPPER VERTICES = " << numClipped << std::endl;
+	std::cout << ">> VERTICES WITHOUT RASTER POSITION = " << numMissing << std::endl;
+}
+
+void SoftwareRenderer::CompareVisibilityBuffer()
+{
+	const bool wasUsingVisibilityBuffer{ m_UsingVisibilityBuffer };
+	const RenderState originalState{ m_State };
+	const int numPixels{ m_BufferWidth * m_BufferHeight };
+
+	const RenderState states[]{ RenderState::combined, RenderState::depth, RenderState::observedArea, RenderState::phong, RenderState::diffuse, RenderState::boundingBox };
+	const char* stateNames[]{ "COMBINED", "DEPTH", "OBSERVED AREA", "PHONG", "DIFFUSE", "BOUNDING BOX" };
+
+	std::cout << "**VISIBILITY BUFFER COMPARISON** deferred vs forward\n";
+
+	SDL_LockSurface(m_pBackBuffer);
+	for (int i{}; i < static_cast<int>(std::size(states)); ++i)
+	{
+		m_State = states[i];
+
+		m_UsingVisibilityBuffer = false;
+		RenderMesh();
+		const std::vector<uint32_t> referenceColors(m_pColorBufferPixels, m_pColorBufferPixels + numPixels);
 
-	//@END
-	//Update SDL Surface
+		m_UsingVisibilityBuffer = true;
+		RenderMesh();
+
+		int colorMismatches{};
+		for (int pixel{}; pixel < numPixels; ++pixel)
+		{
+			if (referenceColors[pixel] != m_pColorBufferPixels[pixel]) ++colorMismatches;
+		}
+
+		std::cout << ">> " << stateNames[i] << " COLOR MISMATCHES = " << colorMismatches << std::endl;
+	}
 	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
+
+	m_State = originalState;
+	m_UsingVisibilityBuffer = wasUsingVisibilityBuffer;
 }
 
-void SoftwareRenderer::VertexTransformationFunction(const std::vector<Vertex_PosTex>& vertices_in, std::vector<Vertex_Out>& vertices_out, const Matrix& meshWorldMatrix)
+void SoftwareRenderer::BenchmarkBufferLayout(int numFrames)
 {
-	vertices_out.resize(vertices_in.size());
+	const int windowWidth{ m_Width };
+	const int windowHeight{ m_Height };
+	const BufferLayout originalLayout{ m_BufferLayout };
+	const float millisecondsPerCount{ 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
 
-	const Matrix worldViewProjectionMatrix = meshWorldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+	const int resolutions[][2]{ { 640, 480 }, { 1920, 1080 }, { 3840, 2160 } };
+	const BufferLayout layouts[]{ BufferLayout::linear, BufferLayout::blocked };
 
-	for (int i{}; i < vertices_in.size(); ++i)
+	//The camera keeps the window's aspect ratio, only the amount of pixels matters here
+	std::cout << "**BUFFER LAYOUT BENCHMARK** linear vs blocked, " << GetThreadCount() << " threads\n";
+	for (const auto& resolution : resolutions)
 	{
-		Vector4 transformPos = worldViewProjectionMatrix.TransformPoint(Vector4{ vertices_in[i].position, 1 });
+		CreateBuffers(resolution[0], resolution[1]);
+		std::vector<uint32_t> presentedPixels(m_Width * m_Height);
 
-		transformPos.x /= transformPos.w;
-		transformPos.y /= transformPos.w;
-		transformPos.z /= transformPos.w;
+		float frameTimes[std::size(layouts)]{};
+		for (size_t i{}; i < std::size(layouts); ++i)
+		{
+			m_BufferLayout = layouts[i];
 
-		vertices_out[i].position = transformPos;
-		vertices_out[i].uv = vertices_in[i].TexCoord;
-		vertices_out[i].normal = meshWorldMatrix.TransformVector(vertices_in[i].normal).Normalized(); //Normal and tangent in world space
-		vertices_out[i].tangent = meshWorldMatrix.TransformVector(vertices_in[i].tangent).Normalized();
-		vertices_out[i].viewDirection = (meshWorldMatrix.TransformPoint(vertices_in[i].position) - m_pCamera->origin).Normalized();
+			//Warm up, a frame includes converting the colour buffer for presenting
+			RenderMesh();
+			ResolveColorBuffer(presentedPixels.data(), m_Width);
+
+			const uint64_t startTime{ SDL_GetPerformanceCounter() };
+			for (int frame{}; frame < numFrames; ++frame)
+			{
+				RenderMesh();
+				ResolveColorBuffer(presentedPixels.data(), m_Width);
+			}
+			frameTimes[i] = static_cast<float>(SDL_GetPerformanceCounter() - startTime) * millisecondsPerCount / static_cast<float>(numFrames);
+		}
+
+		std::cout << ">> " << m_Width << "x" << m_Height << " | LINEAR = " << frameTimes[0] << " ms | BLOCKED = " << frameTimes[1] << " ms | SPEEDUP = " << frameTimes[0] / frameTimes[1] << "x" << std::endl;
 	}
+
+	m_BufferLayout = originalLayout;
+	CreateBuffers(windowWidth, windowHeight);
 }
 
-void SoftwareRenderer::RenderTriangle(const Vertex_Out& v0, const Vertex_Out& v1, const Vertex_Out& v2) const
+void SoftwareRenderer::BenchmarkVertexTransform(int numIterations)
 {
-	ColorRGB finalColor{  };
+	const float microsecondsPerCount{ 1000000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+	const VertexStreams& streams{ m_pMesh->GetVertexStreams() };
+	const int numVertices{ static_cast<int>(streams.positionX.size()) };
+	const Matrix& worldMatrix{ m_pMesh->m_WorldMatrix };
+	const VertexKernels::TransformSetup setup{ VertexKernels::CreateTransformSetup(worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix, worldMatrix, m_pCamera->origin, m_Width, m_Height) };
+
+	std::vector<Vertex_Out> referenceVertices{};
+	std::vector<Vertex_Raster> referenceRasterVertices{};
+	std::vector<Vertex_Out> vertices(numVertices);
+	std::vector<Vertex_Raster> rasterVertices(numVertices);
+
+	//Average time of one pass in microseconds
+	const auto measure = [&](const auto& pass)
+	{
+		pass();
+		const uint64_t startTime{ SDL_GetPerformanceCounter() };
+		for (int iteration{}; iteration < numIterations; ++iteration)
+		{
+			pass();
+		}
+		return static_cast<float>(SDL_GetPerformanceCounter() - startTime) * microsecondsPerCount / static_cast<float>(numIterations);
+	};
+
+	const auto countMismatches = [&]()
+	{
+		int mismatches{};
+		for (int i{}; i < numVertices; ++i)
+		{
+			if (std::memcmp(&vertices[i], &referenceVertices[i], sizeof(Vertex_Out)) != 0
+				|| std::memcmp(&rasterVertices[i], &referenceRasterVertices[i], sizeof(Vertex_Raster)) != 0) ++mismatches;
+		}
+		return mismatches;
+	};
 
-	//checking if pixel is in triangle
-	//Bounding box
-	Vector2 topLeft{ std::min(v0.position.x - 1 , v1.position.x - 1), std::min(v0.position.y - 1, v1.position.y - 1) };
-	Vector2 bottomRight{ std::max(v0.position.x + 1, v1.position.x + 1), std::max(v0.position.y + 1, v1.position.y + 1) };
+	std::cout << "**VERTEX TRANSFORM BENCHMARK** " << numVertices << " vertices, " << GetThreadCount() << " threads\n";
 
-	topLeft = Vector2{ std::min(topLeft.x - 1, v2.position.x - 1), std::min(topLeft.y - 1, v2.position.y - 1) };
-	bottomRight = Vector2{ std::max(bottomRight.x + 1, v2.position.x + 1), std::max(bottomRight.y + 1, v2.position.y + 1) };
+	const float referenceTime{ measure([&]() { VertexTransformationReference(m_pMesh->GetVertices(), referenceVertices, referenceRasterVertices, worldMatrix); }) };
+	std::cout << ">> AOS LOOP = " << referenceTime << " us" << std::endl;
 
-	topLeft.x = Clamp((int)topLeft.x, 0, m_Width - 1);
-	bottomRight.x = Clamp((int)bottomRight.x, 0, m_Width - 1);
-	topLeft.y = Clamp((int)topLeft.y, 0, m_Height - 1);
-	bottomRight.y = Clamp((int)bottomRight.y, 0, m_Height - 1);
+	const VertexKernels::KernelSet* kernelSets[]{ &VertexKernels::GetScalarKernels(), m_pVertexKernels };
+	float kernelTimes[std::size(kernelSets)]{};
+	for (size_t i{}; i < std::size(kernelSets); ++i)
+	{
+		const VertexKernels::KernelSet* pKernels{ kernelSets[i] };
+		kernelTimes[i] = measure([&]() { pKernels->pTransform(setup, streams, 0, numVertices, vertices.data(), rasterVertices.data()); });
+		std::cout << ">> SOA " << pKernels->name << " 1 THREAD = " << kernelTimes[i] << " us | SPEEDUP = " << referenceTime / kernelTimes[i] << "x | MISMATCHES = " << countMismatches() << std::endl;
+	}
 
-	for (int py{ int(topLeft.y) }; py < bottomRight.y; ++py)
+	//The reference is in world space, so the frame's transform has to be as well
+	const LightingSpace originalSpace{ m_LightingSpace };
+	m_LightingSpace = LightingSpace::world;
+	const float parallelTime{ measure([&]() { VertexTransformationFunction(streams, vertices, rasterVertices, worldMatrix); }) };
+	std::cout << ">> SOA " << m_pVertexKernels->name << " PARALLEL = " << parallelTime << " us | SPEEDUP = " << referenceTime / parallelTime << "x | MISMATCHES = " << countMismatches() << std::endl;
+	m_LightingSpace = originalSpace;
+
+	//Lit in object space the attributes are copied and only the view direction is computed, the scalar kernel is the reference there
+	const Vector3 objectCameraOrigin{ Matrix::InverseAffine(worldMatrix).TransformPoint(m_pCamera->origin) };
+	const VertexKernels::TransformSetup objectSetup{ VertexKernels::CreateTransformSetup(worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix, worldMatrix, objectCameraOrigin, m_Width, m_Height) };
+	for (size_t i{}; i < std::size(kernelSets); ++i)
 	{
-		for (int px{ int(topLeft.x) }; px < bottomRight.x; ++px)
+		const VertexKernels::KernelSet* pKernels{ kernelSets[i] };
+		const float kernelTime{ measure([&]() { pKernels->pTransformObjectSpace(objectSetup, streams, 0, numVertices, vertices.data(), rasterVertices.data()); }) };
+		if (i == 0)
 		{
-			if (m_State == RenderState::boundingBox)
-			{
-				finalColor = ColorRGB{ 1.f, 1.f, 1.f };
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
-				continue;
-			}
-			const Vector2 pixelPos = Vector2{ (float)px, (float)py };
+			referenceVertices = vertices;
+			referenceRasterVertices = rasterVertices;
+		}
+		std::cout << ">> OBJECT SPACE " << pKernels->name << " 1 THREAD = " << kernelTime << " us | SPEEDUP OVER WORLD SPACE = " << kernelTimes[i] / kernelTime << "x | MISMATCHES = " << countMismatches() << std::endl;
+	}
+}
+
+void SoftwareRenderer::BenchmarkTextureFiltering(int numFrames)
+{
+	const Texture::Filter originalFilter{ m_SampleFilter };
+	const RenderState originalState{ m_State };
+	const Matrix originalWorldMatrix{ m_pMesh->m_WorldMatrix };
+	const float millisecondsPerCount{ 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
 
-			//side A cross check
-			const Vector2 sideA = Vector2{ v1.position.x - v0.position.x,
-										   v1.position.y - v0.position.y };
+	const Texture::Filter filters[]{ Texture::Filter::point, Texture::Filter::bilinear, Texture::Filter::trilinear };
+	const float distances[]{ 0.f, 150.f };
+	const char* distanceNames[]{ "NEAR", "FAR" };
 
-			const Vector2 vertex1ToPixel = Vector2{ pixelPos.x - v0.position.x,
-													pixelPos.y - v0.position.y };
+	std::cout << "**TEXTURE FILTER BENCHMARK** combined state, " << m_pTexture->GetNumMipLevels() << " mip levels, " << GetThreadCount() << " threads\n";
 
-			const float crossA{ Vector2::Cross(sideA, vertex1ToPixel) };
+	SDL_LockSurface(m_pBackBuffer);
+	m_State = RenderState::combined;
+	for (int i{}; i < static_cast<int>(std::size(distances)); ++i)
+	{
+		//Further away every pixel covers more texels, so the level of detail goes up
+		m_pMesh->m_WorldMatrix = originalWorldMatrix * Matrix::CreateTranslation(Vector3{ 0.f, 0.f, distances[i] });
+
+		float frameTimes[std::size(filters)]{};
+		for (size_t filter{}; filter < std::size(filters); ++filter)
+		{
+			m_SampleFilter = filters[filter];
 
-			//side B cross check
-			const Vector2 sideB = Vector2{ v2.position.x - v1.position.x,
-										   v2.position.y - v1.position.y };
+			//Warm up
+			RenderMesh();
 
-			const Vector2 vertex2ToPixel = Vector2{ pixelPos.x - v1.position.x,
-													pixelPos.y - v1.position.y };
+			const uint64_t startTime{ SDL_GetPerformanceCounter() };
+			for (int frame{}; frame < numFrames; ++frame)
+			{
+				RenderMesh();
+			}
+			frameTimes[filter] = static_cast<float>(SDL_GetPerformanceCounter() - startTime) * millisecondsPerCount / static_cast<float>(numFrames);
+		}
 
-			const float crossB{ Vector2::Cross(sideB, vertex2ToPixel) };
+		std::cout << ">> " << distanceNames[i] << " | POINT = " << frameTimes[0] << " ms | BILINEAR = " << frameTimes[1] << " ms | TRILINEAR = " << frameTimes[2] << " ms" << std::endl;
+	}
+	SDL_UnlockSurface(m_pBackBuffer);
 
-			//side C cross check
-			const Vector2 sideC = Vector2{ v0.position.x - v2.position.x,
-										   v0.position.y - v2.position.y };
+	m_pMesh->m_WorldMatrix = originalWorldMatrix;
+	m_State = originalState;
+	m_SampleFilter = originalFilter;
+}
 
-			const Vector2 vertex3ToPixel = Vector2{ pixelPos.x - v2.position.x,
-													pixelPos.y - v2.position.y };
+void SoftwareRenderer::BenchmarkTextureLayout(int numSamples)
+{
+	const Texture::Layout originalLayout{ m_pTexture->GetLayout() };
+	const float nanosecondsPerCount{ 1'000'000'000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+
+	//Walks like a span of pixels on a rotated surface, a texel and a half per step in a random direction
+	constexpr int walkLength{ 64 };
+	constexpr float texelStep{ 1.5f / 1024.f };
+	std::mt19937 randomEngine{ 1234 };
+	std::uniform_real_distribution<float> randomUnit{ 0.f, 1.f };
+
+	std::vector<Vector2> uvs(numSamples);
+	Vector2 uv{};
+	Vector2 step{};
+	for (int i{}; i < numSamples; ++i)
+	{
+		if (i % walkLength == 0)
+		{
+			const float angle{ randomUnit(randomEngine) * 2.f * PI };
+			uv = Vector2{ randomUnit(randomEngine), randomUnit(randomEngine) };
+			step = Vector2{ std::cos(angle) * texelStep, std::sin(angle) * texelStep };
+		}
+		uvs[i] = uv;
+		uv.x = uv.x + step.x - std::floor(uv.x + step.x);
+		uv.y = uv.y + step.y - std::floor(uv.y + step.y);
+	}
 
-			const float crossC{ Vector2::Cross(sideC, vertex3ToPixel) };
+	const Texture::Layout layouts[]{ Texture::Layout::rowMajor, Texture::Layout::blocked, Texture::Layout::morton };
+	const char* layoutNames[]{ "ROW-MAJOR", "BLOCKED 4X4", "MORTON" };
 
-			bool pointInTriangle{ false };
+	std::cout << "**TEXTURE LAYOUT BENCHMARK** " << numSamples << " samples along random walks on the full resolution level\n";
+	for (const bool isBilinear : { false, true })
+	{
+		float referenceTime{};
+		float referenceSum{};
+		for (int i{}; i < static_cast<int>(std::size(layouts)); ++i)
+		{
+			m_pTexture->SetLayout(layouts[i]);
 
-			switch (m_CullMode)
+			//The sum keeps the samples from being optimized away and has to be the same for every layout
+			ColorRGB sum{};
+			const uint64_t startTime{ SDL_GetPerformanceCounter() };
+			for (const Vector2& sampleUV : uvs)
 			{
-			case dae::SoftwareRenderer::CullingMode::back:
-				pointInTriangle = crossA >= 0 && crossB >= 0 && crossC >= 0;
-				break;
-			case dae::SoftwareRenderer::CullingMode::front:
-				pointInTriangle = crossA <= 0 && crossB <= 0 && crossC <= 0;
-				break;
-			case dae::SoftwareRenderer::CullingMode::none:
-				pointInTriangle = (crossA >= 0 && crossB >= 0 && crossC >= 0) || (crossA <= 0 && crossB <= 0 && crossC <= 0);
-				break;
+				sum += isBilinear ? m_pTexture->Sample<Texture::Filter::bilinear>(sampleUV, 0.f) : m_pTexture->Sample<Texture::Filter::point>(sampleUV, 0.f);
 			}
+			const float sampleTime{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numSamples) };
 
-			if (!pointInTriangle) continue;
-
-			//pixel is in triangle		
-			float weight2 = crossA;
-			float weight0 = crossB;
-			float weight1 = crossC;
+			if (i == 0)
+			{
+				referenceTime = sampleTime;
+				referenceSum = sum.r + sum.g + sum.b;
+			}
 
-			const float totalWeight{ weight0 + weight1 + weight2 };
+			std::cout << ">> " << (isBilinear ? "BILINEAR " : "POINT ") << layoutNames[i] << " = " << sampleTime << " ns | SPEEDUP = " << referenceTime / sampleTime
+				<< "x | " << (sum.r + sum.g + sum.b == referenceSum ? "SAME" : "DIFFERENT") << " RESULT" << std::endl;
+		}
+	}
 
-			weight0 /= totalWeight;
-			weight1 /= totalWeight;
-			weight2 /= totalWeight;
+	m_pTexture->SetLayout(originalLayout);
+}
 
-			//const float interpolatedDepth = v0.position.z * weight0 + v1.position.z * weight1 + v2.position.z * weight2; //Linear
-			const float interpolatedZDepth = 1.f /
-				(
-					(1.f / v0.position.z) * weight0 +
-					(1.f / v1.position.z) * weight1 +
-					(1.f / v2.position.z) * weight2
-					); //Quadratic-ish?
+template<Texture::Filter Filter>
+static void BenchmarkBatchFilter(const Texture* pTexture, const std::vector<float>& us, const std::vector<float>& vs, const std::vector<float>& lods, const std::vector<uint32_t>& laneMasks, const char* name)
+{
+	const float nanosecondsPerCount{ 1'000'000'000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+	const int numBatches{ static_cast<int>(laneMasks.size()) };
 
-			if (interpolatedZDepth < 0 || interpolatedZDepth > 1) continue; //Interpolated depth not in [0,1] range, frustrum culling for z
+	//The sums keep the samples from being optimized away, lanes outside the mask add 0 so they have to be the same
+	float scalarSum{};
+	uint64_t startTime{ SDL_GetPerformanceCounter() };
+	for (int batch{}; batch < numBatches; ++batch)
+	{
+		for (int lane{}; lane < 8; ++lane)
+		{
+			if ((laneMasks[batch] & (1u << lane)) == 0) continue;
+			const int i{ batch * 8 + lane };
+			scalarSum += pTexture->SampleRGBA<Filter>(Vector2{ us[i], vs[i] }, lods[i]).r;
+		}
+	}
+	const float scalarTime{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numBatches * 8) };
 
-			if (m_pDepthBufferPixels[px * m_Height + py] < interpolatedZDepth) continue; //Depth test
+	float batchSum{};
+	Texture::RGBABatch<8> result{};
+	startTime = SDL_GetPerformanceCounter();
+	for (int batch{}; batch < numBatches; ++batch)
+	{
+		const int i{ batch * 8 };
+		pTexture->Sample8<Filter>(&us[i], &vs[i], &lods[i], laneMasks[batch], result);
+		for (const float red : result.r) batchSum += red;
+	}
+	const float batchTime{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numBatches * 8) };
 
-			m_pDepthBufferPixels[px * m_Height + py] = interpolatedZDepth; //Depth write
+	//Every sampled lane of both batch sizes has to match the single sample bit for bit, the others have to be 0
+	int numMismatches{};
+	Texture::RGBABatch<4> halfResult{};
+	for (int batch{}; batch < numBatches; ++batch)
+	{
+		const int i{ batch * 8 };
+		pTexture->Sample8<Filter>(&us[i], &vs[i], &lods[i], laneMasks[batch], result);
+		pTexture->Sample4<Filter>(&us[i], &vs[i], &lods[i], laneMasks[batch], halfResult);
+		for (int lane{}; lane < 8; ++lane)
+		{
+			Texture::RGBA expected{};
+			if (laneMasks[batch] & (1u << lane)) expected = pTexture->SampleRGBA<Filter>(Vector2{ us[i + lane], vs[i + lane] }, lods[i + lane]);
+			const Texture::RGBA sampled{ result.r[lane], result.g[lane], result.b[lane], result.a[lane] };
+			if (std::memcmp(&sampled, &expected, sizeof(Texture::RGBA)) != 0) ++numMismatches;
+			if (lane >= 4) continue;
+			const Texture::RGBA halfSampled{ halfResult.r[lane], halfResult.g[lane], halfResult.b[lane], halfResult.a[lane] };
+			if (std::memcmp(&halfSampled, &expected, sizeof(Texture::RGBA)) != 0) ++numMismatches;
+		}
+	}
 
-			//const Vector2 interpolatedUV = v0.uv * weight0 + v1.uv * weight1 + v2.uv * weight2; //Linear
-			const float	interpolatedWDepth = 1.f /
-					(
-					(1.f / v0.position.w) * weight0 +
-					(1.f / v1.position.w) * weight1 +
-					(1.f / v2.position.w) * weight2
-					); //Quadratic-ish?
+	std::cout << ">> " << name << " = " << scalarTime << " ns SINGLE | " << batchTime << " ns BATCH | SPEEDUP = " << scalarTime / batchTime
+		<< "x | " << (scalarSum == batchSum ? "SAME" : "DIFFERENT") << " RESULT | MISMATCHES = " << numMismatches << std::endl;
+}
 
-			const Vector2 interpolatedUV = (((v0.uv / v0.position.w) * weight0) +
-											((v1.uv / v1.position.w) * weight1) +
-											((v2.uv / v2.position.w) * weight2))
-											* interpolatedWDepth;		
+void SoftwareRenderer::BenchmarkBatchSampling(int numBatches)
+{
+	const Texture::Layout originalLayout{ m_pTexture->GetLayout() };
+
+	//The lanes of a batch are neighbouring pixels, a texel and a half apart, with a random lod per batch
+	//About one batch in four has a partial lane mask, like the edges of a triangle
+	constexpr float texelStep{ 1.5f / 1024.f };
+	std::mt19937 randomEngine{ 1234 };
+	std::uniform_real_distribution<float> randomUnit{ 0.f, 1.f };
+	std::uniform_int_distribution<uint32_t> randomMask{ 1, 255 };
+
+	std::vector<float> us(numBatches * 8);
+	std::vector<float> vs(numBatches * 8);
+	std::vector<float> lods(numBatches * 8);
+	std::vector<uint32_t> laneMasks(numBatches);
+	for (int batch{}; batch < numBatches; ++batch)
+	{
+		const float angle{ randomUnit(randomEngine) * 2.f * PI };
+		const float startU{ randomUnit(randomEngine) };
+		const float startV{ randomUnit(randomEngine) };
+		const float lod{ randomUnit(randomEngine) * (m_pTexture->GetNumMipLevels() + 1) - 1.f };
+		for (int lane{}; lane < 8; ++lane)
+		{
+			const int i{ batch * 8 + lane };
+			const float u{ startU + std::cos(angle) * texelStep * lane };
+			const float v{ startV + std::sin(angle) * texelStep * lane };
+			us[i] = u - std::floor(u);
+			vs[i] = v - std::floor(v);
+			lods[i] = lod;
+		}
+		laneMasks[batch] = randomUnit(randomEngine) < 0.75f ? 0xFF : randomMask(randomEngine);
+	}
 
-			if (interpolatedUV.x < 0 || interpolatedUV.y < 0)
-			{
-				continue;
-			}
+	const Texture::Layout layouts[]{ Texture::Layout::rowMajor, Texture::Layout::blocked, Texture::Layout::morton };
+	const char* layoutNames[]{ "ROW-MAJOR", "BLOCKED 4X4", "MORTON" };
 
-			if (interpolatedUV.x > 1 || interpolatedUV.y > 1)
-			{
-				continue;
-			}
-		
-			Vertex_Out outputPixel;
-			outputPixel.position = Vector4{ pixelPos.x, pixelPos.y, interpolatedZDepth, interpolatedWDepth };
+	std::cout << "**BATCH SAMPLING BENCHMARK** " << numBatches << " batches of 8 lanes, time per lane\n";
+	for (int i{}; i < static_cast<int>(std::size(layouts)); ++i)
+	{
+		m_pTexture->SetLayout(layouts[i]);
+		const std::string layoutName{ layoutNames[i] };
+		BenchmarkBatchFilter<Texture::Filter::point>(m_pTexture, us, vs, lods, laneMasks, ("POINT " + layoutName).c_str());
+		BenchmarkBatchFilter<Texture::Filter::bilinear>(m_pTexture, us, vs, lods, laneMasks, ("BILINEAR " + layoutName).c_str());
+		BenchmarkBatchFilter<Texture::Filter::trilinear>(m_pTexture, us, vs, lods, laneMasks, ("TRILINEAR " + layoutName).c_str());
+	}
 
-			outputPixel.uv = interpolatedUV;
+	m_pTexture->SetLayout(originalLayout);
+}
 
-			outputPixel.normal = ((((v0.normal / v0.position.w) * weight0) +
-								 ((v1.normal / v1.position.w) * weight1) +
-								 ((v2.normal / v2.position.w) * weight2))
-								 * interpolatedWDepth).Normalized();
+SoftwareRenderer::ColorDifference SoftwareRenderer::CompareColorBuffer(const std::vector<uint32_t>& referenceColors) const
+{
+	const int numPixels{ m_BufferWidth * m_BufferHeight };
 
-			outputPixel.tangent = ((((v0.tangent / v0.position.w) * weight0) +
-								  ((v1.tangent / v1.position.w) * weight1) +
-								  ((v2.tangent / v2.position.w) * weight2))
-								  * interpolatedWDepth).Normalized();
+	//Every channel is 8 bits whatever the pixel format, so the bytes are compared one by one
+	ColorDifference colorDifference{};
+	uint64_t totalDifference{};
+	for (int pixel{}; pixel < numPixels; ++pixel)
+	{
+		if (m_pDepthBufferPixels[pixel] == FLT_MAX) continue;
+		++colorDifference.coveredPixels;
 
-			outputPixel.viewDirection = ((((v0.viewDirection / v0.position.w) * weight0) +
-										((v1.viewDirection / v1.position.w) * weight1) +
-										((v2.viewDirection / v2.position.w) * weight2))
-										* interpolatedWDepth).Normalized();
+		bool isDifferent{};
+		for (int channel{}; channel < 3; ++channel)
+		{
+			const int shift{ channel * 8 };
+			const int reference{ static_cast<int>((referenceColors[pixel] >> shift) & 0xFF) };
+			const int current{ static_cast<int>((m_pColorBufferPixels[pixel] >> shift) & 0xFF) };
+			const int difference{ std::abs(current - reference) };
+			colorDifference.maxDifference = std::max(colorDifference.maxDifference, difference);
+			totalDifference += difference;
+			isDifferent |= difference != 0;
+		}
+		if (isDifferent) ++colorDifference.differingPixels;
+	}
+	colorDifference.meanDifference = colorDifference.coveredPixels != 0 ? static_cast<float>(totalDifference) / static_cast<float>(colorDifference.coveredPixels * 3) : 0.f;
+	return colorDifference;
+}
 
-			finalColor = PixelShading(outputPixel);
+template<typename Mode>
+SoftwareRenderer::ModeComparison SoftwareRenderer::CompareModes(int numFrames, Mode& mode, Mode referenceMode, Mode testMode)
+{
+	const int numPixels{ m_BufferWidth * m_BufferHeight };
+	const float millisecondsPerCount{ 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
 
-			finalColor.MaxToOne();
+	const auto renderFrames = [&](Mode frameMode)
+	{
+		mode = frameMode;
 
-			m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-				static_cast<uint8_t>(finalColor.r * 255),
-				static_cast<uint8_t>(finalColor.g * 255),
-				static_cast<uint8_t>(finalColor.b * 255));
+		//Warm up, also leaves the frame to compare in the buffers
+		RenderMesh();
 
+		const uint64_t startTime{ SDL_GetPerformanceCounter() };
+		for (int frame{}; frame < numFrames; ++frame)
+		{
+			RenderMesh();
 		}
-	}
+		return static_cast<float>(SDL_GetPerformanceCounter() - startTime) * millisecondsPerCount / static_cast<float>(numFrames);
+	};
+
+	ModeComparison comparison{};
+	comparison.referenceTime = renderFrames(referenceMode);
+	const std::vector<uint32_t> referenceColors(m_pColorBufferPixels, m_pColorBufferPixels + numPixels);
+	comparison.testTime = renderFrames(testMode);
+	comparison.difference = CompareColorBuffer(referenceColors);
+	return comparison;
 }
 
-bool SoftwareRenderer::SaveBufferToImage() const
+template<typename Operation>
+float SoftwareRenderer::TimeBlocks(int numBlocks, Operation operation)
 {
-	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+	const float nanosecondsPerCount{ 1'000'000'000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+
+	float bestTime{ FLT_MAX };
+	for (int repeat{}; repeat < 10; ++repeat)
+	{
+		const uint64_t startTime{ SDL_GetPerformanceCounter() };
+		for (int block{}; block < numBlocks; ++block)
+		{
+			operation(block);
+		}
+		const float time{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * nanosecondsPerCount / static_cast<float>(numBlocks * m_ShadingWidth) };
+		bestTime = std::min(bestTime, time);
+	}
+	return bestTime;
 }
 
-void SoftwareRenderer::RenderMesh()
+void SoftwareRenderer::CompareSpecularModes(int numFrames)
 {
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
-	SDL_FillRect(m_pBackBuffer, &m_pBackBuffer->clip_rect, 100);
+	const SpecularMode originalMode{ m_SpecularMode };
+	const RenderState originalState{ m_State };
+	const RenderState states[]{ RenderState::phong, RenderState::combined };
+	const char* stateNames[]{ "PHONG", "COMBINED" };
 
-	if (m_ShouldUseUniformColor)
+	std::cout << "**SPECULAR COMPARISON** fast pow vs exact, colour differences in 8 bit steps over the covered pixels\n";
+
+	SDL_LockSurface(m_pBackBuffer);
+	for (int i{}; i < static_cast<int>(std::size(states)); ++i)
 	{
-		ColorRGB clearColor{ m_UniformColor.r * 255, m_UniformColor.g * 255 ,m_UniformColor.b * 255 };
-		Uint32 clearColorUint = 0xFF000000 | (Uint32)clearColor.r | (Uint32)clearColor.g << 8 | (Uint32)clearColor.b << 16;
-		SDL_FillRect(m_pBackBuffer, NULL, clearColorUint);
+		m_State = states[i];
+
+		const ModeComparison comparison{ CompareModes(numFrames, m_SpecularMode, SpecularMode::exact, SpecularMode::fastPow) };
+		const ColorDifference& difference{ comparison.difference };
+		std::cout << ">> " << stateNames[i] << " | EXACT = " << comparison.referenceTime << " ms | FAST = " << comparison.testTime << " ms | DIFFERING PIXELS = " << difference.differingPixels << "/" << difference.coveredPixels
+			<< " | MAX DIFFERENCE = " << difference.maxDifference << " | MEAN DIFFERENCE = " << difference.meanDifference << std::endl;
 	}
-	else
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	m_State = originalState;
+	m_SpecularMode = originalMode;
+
+	//The Phong term on its own, over random normals, view directions and gloss in the range of the material
+	constexpr int numBlocks{ 1 << 14 };
+	std::mt19937 randomEngine{ 1234 };
+	std::uniform_real_distribution<float> randomValue{ -1.f, 1.f };
+	std::uniform_real_distribution<float> randomUnit{ 0.f, 1.f };
+
+	std::vector<BlockVectors> normals(numBlocks);
+	std::vector<BlockVectors> viewDirections(numBlocks);
+	std::vector<BlockFloats> speculars(numBlocks);
+	std::vector<BlockFloats> exponents(numBlocks);
+	for (int block{}; block < numBlocks; ++block)
+	{
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
+		{
+			const Vector3 normal{ Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) }.Normalized() };
+			const Vector3 viewDirection{ Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) }.Normalized() };
+			normals[block].x[lane] = normal.x;
+			normals[block].y[lane] = normal.y;
+			normals[block].z[lane] = normal.z;
+			viewDirections[block].x[lane] = viewDirection.x;
+			viewDirections[block].y[lane] = viewDirection.y;
+			viewDirections[block].z[lane] = viewDirection.z;
+			speculars[block][lane] = randomUnit(randomEngine);
+			exponents[block][lane] = randomUnit(randomEngine) * 25.f;
+		}
+	}
+
+	std::vector<BlockColors> exactColors(numBlocks);
+	std::vector<BlockColors> fastColors(numBlocks);
+	const float exactTime{ TimeBlocks(numBlocks, [&](int block) { exactColors[block] = Phong<SpecularMode::exact>(speculars[block], exponents[block], -m_Light.direction, viewDirections[block], normals[block]); }) };
+	const float fastTime{ TimeBlocks(numBlocks, [&](int block) { fastColors[block] = Phong<SpecularMode::fastPow>(speculars[block], exponents[block], -m_Light.direction, viewDirections[block], normals[block]); }) };
+
+	float maxError{};
+	double totalError{};
+	for (int block{}; block < numBlocks; ++block)
 	{
-		Uint32 clearColorUint = 0xFF000000 | (Uint32)m_ClearColor.r | (Uint32)m_ClearColor.g << 8 | (Uint32)m_ClearColor.b << 16;
-		SDL_FillRect(m_pBackBuffer, NULL, clearColorUint);
-	}	
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
+		{
+			const float error{ std::abs(fastColors[block].r[lane] - exactColors[block].r[lane]) };
+			maxError = std::max(maxError, error);
+			totalError += error;
+		}
+	}
 
-	//RENDER LOGIC
+	std::cout << ">> PHONG PER PIXEL | EXACT = " << exactTime << " ns | FAST = " << fastTime << " ns | SPEEDUP = " << exactTime / fastTime
+		<< "x | MAX ERROR = " << maxError << " | MEAN ERROR = " << totalError / static_cast<double>(numBlocks * m_ShadingWidth) << std::endl;
+}
 
-	//convert to screen space
-	VertexTransformationFunction(m_pMesh->GetVertices(), m_pMesh->m_Vertices_out, m_pMesh->m_WorldMatrix);
+void SoftwareRenderer::CompareLightingSpaces(int numFrames)
+{
+	const LightingSpace originalSpace{ m_LightingSpace };
+	const RenderState originalState{ m_State };
+	const bool originalNormalMap{ m_UsingNormalMap };
+	const Matrix originalWorldMatrix{ m_pMesh->m_WorldMatrix };
+	const RenderState states[]{ RenderState::observedArea, RenderState::phong, RenderState::combined };
+	const char* stateNames[]{ "OBSERVED AREA", "PHONG", "COMBINED" };
+	//Turned as well, so the light and the camera really get rotated into object space
+	const Matrix worldMatrices[]{ originalWorldMatrix, Matrix::CreateRotationY(PI / 3.f) * originalWorldMatrix };
+	const char* poseNames[]{ "AS IS", "TURNED" };
+
+	std::cout << "**LIGHTING SPACE COMPARISON** object vs world space with the normal map, colour differences in 8 bit steps over the covered pixels\n";
 
-	if (m_pMesh->m_topology == PrimitiveTopology::TriangleList)
+	SDL_LockSurface(m_pBackBuffer);
+	m_UsingNormalMap = true;
+	for (int pose{}; pose < static_cast<int>(std::size(worldMatrices)); ++pose)
 	{
-		for (size_t i{}; i < m_pMesh->GetIndices().size() / 3; ++i)
+		m_pMesh->m_WorldMatrix = worldMatrices[pose];
+		for (int i{}; i < static_cast<int>(std::size(states)); ++i)
 		{
-			Vertex_Out v0 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i * 3]];
-			Vertex_Out v1 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i * 3 + 1]];
-			Vertex_Out v2 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i * 3 + 2]];
+			m_State = states[i];
+
+			const ModeComparison comparison{ CompareModes(numFrames, m_LightingSpace, LightingSpace::world, LightingSpace::object) };
+			const ColorDifference& difference{ comparison.difference };
+			std::cout << ">> " << poseNames[pose] << " " << stateNames[i] << " | WORLD = " << comparison.referenceTime << " ms | OBJECT = " << comparison.testTime << " ms | DIFFERING PIXELS = " << difference.differingPixels << "/" << difference.coveredPixels
+				<< " | MAX DIFFERENCE = " << difference.maxDifference << " | MEAN DIFFERENCE = " << difference.meanDifference << std::endl;
+		}
+	}
+	SDL_UnlockSurface(m_pBackBuffer);
 
-			if ((v0.position.x < -1 || v0.position.x > 1) || (v0.position.y < -1 || v0.position.y > 1)) continue;
-			if ((v1.position.x < -1 || v1.position.x > 1) || (v1.position.y < -1 || v1.position.y > 1)) continue;
-			if ((v2.position.x < -1 || v2.position.x > 1) || (v2.position.y < -1 || v2.position.y > 1)) continue;
+	m_pMesh->m_WorldMatrix = originalWorldMatrix;
+	m_UsingNormalMap = originalNormalMap;
+	m_State = originalState;
+	m_LightingSpace = originalSpace;
+}
 
-			//NDC to raster space
-			v0.position.x = (v0.position.x + 1) / 2.f * m_Width;
-			v0.position.y = (1 - v0.position.y) / 2.f * m_Height;
+void SoftwareRenderer::CompareNormalizeModes(int numFrames)
+{
+	const NormalizeMode originalMode{ m_NormalizeMode };
+	const RenderState originalState{ m_State };
+	const bool originalNormalMap{ m_UsingNormalMap };
+	const RenderState states[]{ RenderState::observedArea, RenderState::phong, RenderState::combined };
+	const char* stateNames[]{ "OBSERVED AREA", "PHONG", "COMBINED" };
 
-			v1.position.x = (v1.position.x + 1) / 2.f * m_Width;
-			v1.position.y = (1 - v1.position.y) / 2.f * m_Height;
+	std::cout << "**NORMALIZATION COMPARISON** fast rsqrt vs exact, colour differences in 8 bit steps over the covered pixels\n";
 
-			v2.position.x = (v2.position.x + 1) / 2.f * m_Width;
-			v2.position.y = (1 - v2.position.y) / 2.f * m_Height;
+	SDL_LockSurface(m_pBackBuffer);
+	for (const bool usingNormalMap : { true, false })
+	{
+		m_UsingNormalMap = usingNormalMap;
+		for (int i{}; i < static_cast<int>(std::size(states)); ++i)
+		{
+			m_State = states[i];
 
-			RenderTriangle(v0, v1, v2);
+			const ModeComparison comparison{ CompareModes(numFrames, m_NormalizeMode, NormalizeMode::exact, NormalizeMode::fastRSqrt) };
+			const ColorDifference& difference{ comparison.difference };
+			std::cout << ">> " << stateNames[i] << (usingNormalMap ? " NORMAL MAP" : "") << " | EXACT = " << comparison.referenceTime << " ms | FAST = " << comparison.testTime << " ms | DIFFERING PIXELS = " << difference.differingPixels << "/" << difference.coveredPixels
+				<< " | MAX DIFFERENCE = " << difference.maxDifference << " | MEAN DIFFERENCE = " << difference.meanDifference << std::endl;
 		}
 	}
-	else
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	m_UsingNormalMap = originalNormalMap;
+	m_State = originalState;
+	m_NormalizeMode = originalMode;
+
+	//One normalization on its own, over random directions as long as interpolated unit vectors get
+	constexpr int numBlocks{ 1 << 14 };
+	std::mt19937 randomEngine{ 1234 };
+	std::uniform_real_distribution<float> randomValue{ -1.f, 1.f };
+	std::uniform_real_distribution<float> randomLength{ .5f, 1.f };
+
+	std::vector<BlockVectors> vectors(numBlocks);
+	for (int block{}; block < numBlocks; ++block)
 	{
-		for (size_t i{}; i < m_pMesh->GetIndices().size() - 2; ++i)
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
 		{
-			if (i % 2 != 0)
+			vectors[block].SetLane(lane, Vector3{ randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) }.Normalized() * randomLength(randomEngine));
+		}
+	}
+
+	std::vector<BlockVectors> laneVectors(numBlocks);
+	std::vector<BlockVectors> exactVectors(numBlocks);
+	std::vector<BlockVectors> fastVectors(numBlocks);
+	//One lane at a time is what the exact normalization does while interpolating
+	const float laneTime{ TimeBlocks(numBlocks, [&](int block)
+		{
+			for (int lane{}; lane < m_ShadingWidth; ++lane)
 			{
-				Vertex_Out v0 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i]];
-				Vertex_Out v1 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i + 2]];
-				Vertex_Out v2 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i + 1]];
+				laneVectors[block].SetLane(lane, vectors[block].GetLane(lane).Normalized());
+			}
+		}) };
+	const float exactTime{ TimeBlocks(numBlocks, [&](int block) { exactVectors[block] = vectors[block].Normalized(); }) };
+	const float fastTime{ TimeBlocks(numBlocks, [&](int block) { fastVectors[block] = vectors[block].FastNormalized(); }) };
+
+	//Both keep the direction, so the length is what can be off
+	float maxExactError{};
+	float maxError{};
+	double totalError{};
+	for (int block{}; block < numBlocks; ++block)
+	{
+		const BlockFloats exactLengths{ Sqrt(exactVectors[block].SqrMagnitude()) };
+		const BlockFloats fastLengths{ Sqrt(fastVectors[block].SqrMagnitude()) };
+		for (int lane{}; lane < m_ShadingWidth; ++lane)
+		{
+			const float error{ std::abs(fastLengths[lane] - 1.f) };
+			maxExactError = std::max(maxExactError, std::abs(exactLengths[lane] - 1.f));
+			maxError = std::max(maxError, error);
+			totalError += error;
+		}
+	}
 
-				if ((v0.position.x < -1 || v0.position.x > 1) || (v0.position.y < -1 || v0.position.y > 1)) continue;
-				if ((v1.position.x < -1 || v1.position.x > 1) || (v1.position.y < -1 || v1.position.y > 1)) continue;
-				if ((v2.position.x < -1 || v2.position.x > 1) || (v2.position.y < -1 || v2.position.y > 1)) continue;
+	std::cout << ">> NORMALIZE PER VECTOR | EXACT PER LANE = " << laneTime << " ns | EXACT PER BLOCK = " << exactTime << " ns | FAST = " << fastTime << " ns | SPEEDUP = " << laneTime / fastTime << "x / " << exactTime / fastTime
+		<< "x | MAX LENGTH ERROR = " << maxError << " (EXACT " << maxExactError << ") | MEAN LENGTH ERROR = " << totalError / static_cast<double>(numBlocks * m_ShadingWidth) << std::endl;
+}
 
-				//NDC to raster space
-				v0.position.x = (v0.position.x + 1) / 2.f * m_Width;
-				v0.position.y = (1 - v0.position.y) / 2.f * m_Height;
+void SoftwareRenderer::CheckFrameAllocations(int numFrames)
+{
+	if (!AllocationTracker::IsEnabled())
+	{
+		std::cout << "**FRAME ALLOCATION CHECK** SKIPPED\n";
+		std::cout << ">> Build the Benchmark configuration, which defines TRACK_ALLOCATIONS, to count the heap allocations" << std::endl;
+		return;
+	}
 
-				v1.position.x = (v1.position.x + 1) / 2.f * m_Width;
-				v1.position.y = (1 - v1.position.y) / 2.f * m_Height;
+	//Everything Render does, apart from the blit to the window
+	const int pitch{ m_pBackBuffer->pitch / static_cast<int>(sizeof(uint32_t)) };
+	const auto renderFrame{ [this, pitch]()
+		{
+			SDL_LockSurface(m_pBackBuffer);
+			RenderMesh();
+			ResolveColorBuffer(m_pBackBufferPixels, pitch);
+			SDL_UnlockSurface(m_pBackBuffer);
+		} };
+
+	//The first frames size the per frame buffers
+	renderFrame();
+	renderFrame();
+
+	const uint64_t startCount{ AllocationTracker::GetAllocationCount() };
+	for (int frame{}; frame < numFrames; ++frame)
+	{
+		renderFrame();
+	}
+	const uint64_t numAllocations{ AllocationTracker::GetAllocationCount() - startCount };
 
-				v2.position.x = (v2.position.x + 1) / 2.f * m_Width;
-				v2.position.y = (1 - v2.position.y) / 2.f * m_Height;
+	std::cout << "**FRAME ALLOCATION CHECK** " << (numAllocations == 0 ? "PASSED" : "FAILED") << "\n";
+	std::cout << ">> FRAMES = " << numFrames << std::endl;
+	std::cout << ">> HEAP ALLOCATIONS = " << numAllocations << std::endl;
+}
 
-				RenderTriangle(v0, v1, v2);
-			}
-			else
-			{
-				Vertex_Out v0 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i]];
-				Vertex_Out v1 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i + 1]];
-				Vertex_Out v2 = m_pMesh->m_Vertices_out[m_pMesh->GetIndices()[i + 2]];
+void SoftwareRenderer::PrintRasterStats() const
+{
+	RasterStats totalStats{};
+	for (const RasterStats& stats : m_TileStats)
+	{
+		totalStats.testedTriangles += stats.testedTriangles;
+		totalStats.rejectedTriangles += stats.rejectedTriangles;
+		totalStats.testedBlocks += stats.testedBlocks;
+		totalStats.rejectedBlocks += stats.rejectedBlocks;
+		totalStats.shadedFragments += stats.shadedFragments;
+	}
+
+	std::cout << "Culled: " << m_CullStats.backFacing << " back facing, " << m_CullStats.frontFacing << " front facing, "
+		<< m_CullStats.degenerate << " degenerate, " << m_CullStats.subPixel << " sub-pixel" << std::endl;
+	std::cout << "HiZ rejected: " << totalStats.rejectedTriangles << "/" << totalStats.testedTriangles << " tile triangles, "
+		<< totalStats.rejectedBlocks << "/" << totalStats.testedBlocks << " 8x8 blocks" << std::endl;
+	std::cout << "Shaded fragments: " << totalStats.shadedFragments << (m_UsingDepthPrepass ? " (depth prepass)" : "") << std::endl;
+}
 
-				if ((v0.position.x < -1 || v0.position.x > 1) || (v0.position.y < -1 || v0.position.y > 1)) continue;
-				if ((v1.position.x < -1 || v1.position.x > 1) || (v1.position.y < -1 || v1.position.y > 1)) continue;
-				if ((v2.position.x < -1 || v2.position.x > 1) || (v2.position.y < -1 || v2.position.y > 1)) continue;
+void SoftwareRenderer::BenchmarkThreadScaling(int numFrames)
+{
+	const int originalThreadCount{ GetThreadCount() };
+	const int maxThreadCount{ std::max(static_cast<int>(std::thread::hardware_concurrency()), 1) };
+	const float millisecondsPerCount{ 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
 
-				//NDC to raster space
-				v0.position.x = (v0.position.x + 1) / 2.f * m_Width;
-				v0.position.y = (1 - v0.position.y) / 2.f * m_Height;
+	std::cout << "**THREAD SCALING BENCHMARK STARTED**\n";
+	std::ofstream fileStream("benchmark_threads.txt");
+	fileStream << "FRAMES = " << numFrames << std::endl;
 
-				v1.position.x = (v1.position.x + 1) / 2.f * m_Width;
-				v1.position.y = (1 - v1.position.y) / 2.f * m_Height;
+	float singleThreadFrameTime{};
 
-				v2.position.x = (v2.position.x + 1) / 2.f * m_Width;
-				v2.position.y = (1 - v2.position.y) / 2.f * m_Height;
+	SDL_LockSurface(m_pBackBuffer);
+	for (int numThreads{ 1 }; numThreads <= maxThreadCount; ++numThreads)
+	{
+		SetThreadCount(numThreads);
 
-				RenderTriangle(v0, v1, v2);
-			}
+		//Warm up, first frame after spawning threads is not representative
+		RenderMesh();
+
+		const uint64_t startTime{ SDL_GetPerformanceCounter() };
+		for (int frame{}; frame < numFrames; ++frame)
+		{
+			RenderMesh();
 		}
+		const float frameTime{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) * millisecondsPerCount / static_cast<float>(numFrames) };
+
+		if (numThreads == 1) singleThreadFrameTime = frameTime;
+
+		std::cout << ">> THREADS = " << numThreads << " | FRAME = " << frameTime << " ms | SPEEDUP = " << singleThreadFrameTime / frameTime << "x" << std::endl;
+		fileStream << "THREADS = " << numThreads << " FRAME = " << frameTime << " ms SPEEDUP = " << singleThreadFrameTime / frameTime << std::endl;
 	}
+	SDL_UnlockSurface(m_pBackBuffer);
+
+	SetThreadCount(originalThreadCount);
+	std::cout << "**THREAD SCALING BENCHMARK FINISHED**\n";
 }
 
 void SoftwareRenderer::CycleRenderState()
@@ -406,82 +2084,117 @@ void SoftwareRenderer::ToggleNormalMap()
 	m_UsingNormalMap = !m_UsingNormalMap;
 }
 
-ColorRGB SoftwareRenderer::PixelShading(const Vertex_Out& vertex) const
+template<SoftwareRenderer::RenderState State, bool UsingNormalMap, Texture::Filter Filter, SoftwareRenderer::SpecularMode Specular, SoftwareRenderer::LightingSpace Space, SoftwareRenderer::NormalizeMode Normalize>
+SoftwareRenderer::BlockColors SoftwareRenderer::PixelShading(const ShadingBlock& pixels, uint32_t laneMask) const
 {
-	ColorRGB returnColor{};
-	//normal map
-	Vector3 sampledNormal{ vertex.normal };
+	static_assert(State != RenderState::depth && State != RenderState::boundingBox, "The depth and bounding box views don't shade fragments");
 
-	if (m_UsingNormalMap)
+	//sample diffuse color
+	if constexpr (State == RenderState::diffuse)
 	{
-		const Vector3 binormal{ Vector3::Cross(vertex.normal, vertex.tangent) };
-		const Matrix tangentSpaceAxis{ vertex.tangent,
-										binormal,
-										vertex.normal,
-										Vector3::Zero
-		};
-		const ColorRGB normalColor = m_pNormals->Sample(vertex.uv); //normal
-
-		sampledNormal.x = 2.f * normalColor.r - 1.f;
-		sampledNormal.y = 2.f * normalColor.g - 1.f;
-		sampledNormal.z = 2.f * normalColor.b - 1.f;
+		return SampleTexture<Filter>(m_pTexture, pixels, laneMask) / PI; //Diffuse
+	}
+	else
+	{
+		//normal map, specular and gloss in one fetch
+		BlockTexels material{};
+		if constexpr (UsesMaterial(State, UsingNormalMap))
+		{
+			material = SampleTextureRGBA<Filter>(m_pMaterial, pixels, laneMask);
+		}
 
-		sampledNormal = tangentSpaceAxis.TransformVector(sampledNormal);
+		//normal map
+		BlockVectors sampledNormal{ pixels.normal };
 
-		sampledNormal.Normalize();
-	}
-	//observed area
-	float cosineLaw{ Vector3::Dot(sampledNormal, -m_Light.direction)};
-	cosineLaw = Saturate(cosineLaw);
+		if constexpr (UsingNormalMap)
+		{
+			//In object space the binormal is interpolated from the mesh's, in world space it follows from the normal and tangent
+			BlockVectors binormal{ pixels.binormal };
+			if constexpr (Space == LightingSpace::world) binormal = BlockVectors::Cross(pixels.normal, pixels.tangent);
+
+			//Only x and y are stored, tangent space normals always point out of the surface
+			const BlockFloats tangentX{ 2.f * BlockFloats::Load(material.r) - 1.f };
+			const BlockFloats tangentY{ 2.f * BlockFloats::Load(material.g) - 1.f };
+			const BlockFloats tangentZ{ Sqrt(Max(BlockFloats{}, 1.f - tangentX * tangentX - tangentY * tangentY)) };
+
+			//Tangent space to lighting space, the tangent, binormal and normal are the axes
+			sampledNormal = BlockVectors{
+				pixels.tangent.x * tangentX + binormal.x * tangentY + pixels.normal.x * tangentZ,
+				pixels.tangent.y * tangentX + binormal.y * tangentY + pixels.normal.y * tangentZ,
+				pixels.tangent.z * tangentX + binormal.z * tangentY + pixels.normal.z * tangentZ };
+
+			if constexpr (Normalize == NormalizeMode::fastRSqrt) sampledNormal.FastNormalize();
+			else sampledNormal.Normalize();
+		}
+		else if constexpr (Normalize == NormalizeMode::fastRSqrt)
+		{
+			//Left for the whole block by InterpolatePixel
+			sampledNormal.FastNormalize();
+		}
 
-	//sample diffuse color
-	const ColorRGB diffuseColor = m_pTexture->Sample(vertex.uv) / PI; //Diffuse
+		//observed area
+		const BlockFloats cosineLaw{ Saturate(BlockVectors::Dot(sampledNormal, BlockVectors::Broadcast(-m_ShadingLightDirection))) };
 
-	//Phong
-	const float shininess{ 25.f };
+		if constexpr (State == RenderState::observedArea)
+		{
+			return BlockColors{ cosineLaw, cosineLaw, cosineLaw };
+		}
+		else
+		{
+			//Phong
+			const float shininess{ 25.f };
 
-	const float specular = m_pSpecular->Sample(vertex.uv).r; //Specular
-	const float phongExp = m_pPhongExponent->Sample(vertex.uv).r * shininess; //Phong exponent
+			const BlockFloats specular{ BlockFloats::Load(material.b) }; //Specular
+			const BlockFloats phongExp{ BlockFloats::Load(material.a) * shininess }; //Phong exponent
 
-	const ColorRGB phongColor = Phong(specular, phongExp, -m_Light.direction, vertex.viewDirection, sampledNormal);
+			const BlockColors phongColor = Phong<Specular>(specular, phongExp, -m_ShadingLightDirection, pixels.viewDirection, sampledNormal);
 
-	// Remap the Z depth
-	const float depthRemap{ Remap(vertex.position.z, 0.995f, 1.0f) };
-	switch (m_State)
-	{
-	case RenderState::combined:
-		returnColor = m_Light.intensity * diffuseColor * cosineLaw + phongColor + m_Light.ambientColor;
-		break;
+			if constexpr (State == RenderState::phong)
+			{
+				return phongColor;
+			}
+			else
+			{
+				const BlockColors diffuseColor = SampleTexture<Filter>(m_pTexture, pixels, laneMask) / PI; //Diffuse
 
-	case RenderState::depth:
-		// Set the color to showcase the depth
-		returnColor = { depthRemap, depthRemap, depthRemap };
-		break;
+				return m_Light.intensity * diffuseColor * cosineLaw + phongColor + m_Light.ambientColor;
+			}
+		}
+	}
+}
 
-	case RenderState::observedArea:
-		returnColor = { cosineLaw, cosineLaw, cosineLaw };
-		break;
+template<Texture::Filter Filter>
+SoftwareRenderer::BlockColors SoftwareRenderer::SampleTexture(const Texture* pTexture, const ShadingBlock& pixels, uint32_t laneMask)
+{
+	const BlockTexels colors{ SampleTextureRGBA<Filter>(pTexture, pixels, laneMask) };
+	return BlockColors{ BlockFloats::Load(colors.r), BlockFloats::Load(colors.g), BlockFloats::Load(colors.b) };
+}
 
-	case RenderState::phong:
-		returnColor = phongColor;
-		break;
+template<Texture::Filter Filter>
+SoftwareRenderer::BlockTexels SoftwareRenderer::SampleTextureRGBA(const Texture* pTexture, const ShadingBlock& pixels, uint32_t laneMask)
+{
+	static_assert(m_ShadingWidth == 8, "The batch sampler takes 4 or 8 lanes");
 
-	case RenderState::diffuse:
-		returnColor = diffuseColor;
-		break;
+	float lods[m_ShadingWidth];
+	for (int lane{}; lane < m_ShadingWidth; ++lane)
+	{
+		lods[lane] = pTexture->ComputeLod(pixels.dudx[lane], pixels.dvdx[lane], pixels.dudy[lane], pixels.dvdy[lane]);
 	}
-	
-	return returnColor;
+
+	BlockTexels colors;
+	pTexture->Sample8<Filter>(pixels.uv.x.lanes, pixels.uv.y.lanes, lods, laneMask, colors);
+	return colors;
 }
 
-ColorRGB SoftwareRenderer::Phong(float specular, float exp, const Vector3& l, const Vector3& v, const Vector3& n) const
+template<SoftwareRenderer::SpecularMode Specular>
+SoftwareRenderer::BlockColors SoftwareRenderer::Phong(const BlockFloats& specular, const BlockFloats& exp, const Vector3& l, const BlockVectors& v, const BlockVectors& n) const
 {
 	//todo: W3
 	//assert(false && "Not Implemented Yet");
-	const Vector3 reflect = Vector3::Reflect(l,n);
-	const float cosAlpha = std::max(0.f, Vector3::Dot(reflect, v));
-	const float value = specular * powf(cosAlpha, exp);
-	return ColorRGB{ value,value,value };
+	const BlockVectors reflect = BlockVectors::Reflect(BlockVectors::Broadcast(l), n);
+	const BlockFloats cosAlpha = Max(BlockFloats{}, BlockVectors::Dot(reflect, v));
+	const BlockFloats value = specular * (Specular == SpecularMode::fastPow ? FastPow(cosAlpha, exp) : Pow(cosAlpha, exp));
+	return BlockColors{ value,value,value };
 }
 
 void SoftwareRenderer::ToggleDepthView()
@@ -497,6 +2210,60 @@ void SoftwareRenderer::ToggleDepthView()
 	}
 }
 
+void SoftwareRenderer::ToggleVisibilityBuffer()
+{
+	m_UsingVisibilityBuffer = !m_UsingVisibilityBuffer;
+}
+
+void SoftwareRenderer::ToggleDepthPrepass()
+{
+	m_UsingDepthPrepass = !m_UsingDepthPrepass;
+}
+
+void SoftwareRenderer::CycleSampleFilter()
+{
+	std::cout << "Software sampler: ";
+	switch (m_SampleFilter)
+	{
+	case Texture::Filter::point:
+		m_SampleFilter = Texture::Filter::bilinear;
+		std::cout << "bilinear\n";
+		break;
+	case Texture::Filter::bilinear:
+		m_SampleFilter = Texture::Filter::trilinear;
+		std::cout << "trilinear\n";
+		break;
+	case Texture::Filter::trilinear:
+		m_SampleFilter = Texture::Filter::point;
+		std::cout << "point\n";
+		break;
+	}
+}
+
+void SoftwareRenderer::ToggleFastSpecular()
+{
+	m_SpecularMode = m_SpecularMode == SpecularMode::exact ? SpecularMode::fastPow : SpecularMode::exact;
+	std::cout << "Software specular: " << (m_SpecularMode == SpecularMode::fastPow ? "fast pow\n" : "exact\n");
+}
+
+void SoftwareRenderer::ToggleLightingSpace()
+{
+	m_LightingSpace = m_LightingSpace == LightingSpace::world ? LightingSpace::object : LightingSpace::world;
+	std::cout << "Software lighting space: " << (m_LightingSpace == LightingSpace::object ? "object\n" : "world\n");
+}
+
+void SoftwareRenderer::ToggleFastNormalize()
+{
+	m_NormalizeMode = m_NormalizeMode == NormalizeMode::exact ? NormalizeMode::fastRSqrt : NormalizeMode::exact;
+	std::cout << "Software normalization: " << (m_NormalizeMode == NormalizeMode::fastRSqrt ? "fast rsqrt\n" : "exact\n");
+}
+
+bool SoftwareRenderer::UsesObjectSpaceLighting() const
+{
+	//With a non-uniform scale or shear the dot products of the lighting change between the spaces, so those meshes stay in world space
+	return m_LightingSpace == LightingSpace::object && m_pMesh->m_WorldMatrix.IsConformal();
+}
+
 void SoftwareRenderer::ToggleBoundingBoxView()
 {
 	if (m_State != RenderState::boundingBox)
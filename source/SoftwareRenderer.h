@@ -1,12 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include "BaseRenderer.h"
 #include "Camera.h"
 #include "DataTypes.h"
 #include "Mesh.h"
+#include "Texture.h"
+#include "RasterKernels.h"
+#include "VertexKernels.h"
+#include "ThreadPool.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -40,22 +45,218 @@ namespace dae
 
 		void ToggleBoundingBoxView();
 
+		void ToggleVisibilityBuffer();
+
+		void ToggleDepthPrepass();
+
+		void CycleSampleFilter();
+
+		void ToggleFastSpecular();
+
+		void ToggleLightingSpace();
+
+		void ToggleFastNormalize();
+
 		void SetMesh(Mesh_PosTexSoftwareVehicle* pMesh) { m_pMesh = pMesh; };
 
+		void SetThreadCount(int numThreads);
+		int GetThreadCount() const;
+
+		//Renders the mesh with 1 up to the hardware thread count and reports the frame times
+		void BenchmarkThreadScaling(int numFrames);
+		//Renders a frame with the scalar and the selected SIMD kernel and reports differing pixels
+		void CompareRasterKernels();
+		//Runs the wide types the shading uses on random lanes and counts the lanes that differ from the scalar types
+		void CompareWideTypes(int numBlocks);
+		//Renders with the camera inside the mesh and reports the vertices the clipper made without a raster position
+		void CheckNearClipping();
+		//Renders every render state forward and through the visibility buffer and reports differing pixels
+		void CompareVisibilityBuffer();
+		//Renders the combined state with and without a depth prepass and reports differing pixels and shaded fragments
+		void CompareDepthPrepass();
+		//Renders at 640x480, 1920x1080 and 3840x2160 with the linear and the blocked buffer layout and reports the frame times
+		void BenchmarkBufferLayout(int numFrames);
+		//Times the per vertex AoS transform against the batched SoA kernels and reports differing vertices
+		void BenchmarkVertexTransform(int numIterations);
+		//Renders a few frames after warming up and reports the heap allocations they made, which should be zero
+		void CheckFrameAllocations(int numFrames);
+		//Renders the combined state near and far away with every texture filter and reports the frame times
+		void BenchmarkTextureFiltering(int numFrames);
+		//Samples the diffuse map along random walks with every texel layout and reports the time per sample
+		void BenchmarkTextureLayout(int numSamples);
+		//Samples the diffuse map in batches of 8 lanes and one lane at a time with every filter and layout, reports the time per lane and differing lanes
+		void BenchmarkBatchSampling(int numBatches);
+		//Renders the phong and combined states with the exact and the fast specular, reports the colour differences, the frame times and the Phong cost per pixel
+		void CompareSpecularModes(int numFrames);
+		//Renders the normal mapped states lit in world space and in object space, reports the colour differences and the frame times
+		void CompareLightingSpaces(int numFrames);
+		//Renders the lit states with the exact and the fast normalization, reports the colour differences, the frame times and the error and cost of one normalization
+		void CompareNormalizeModes(int numFrames);
+		//Prints the culling and hierarchical depth rejection counters of the last frame
+		void PrintRasterStats() const;
+
 	private:
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
 
+		//Colour, depth and visibility buffers the rasterizer works in, padded to whole 8x8 blocks
+		//Blocked stores the 64 pixels of every block contiguously, so a block and a row of blocks are one run in memory
+		//Linear is row-major and only kept to compare against, both get converted to the back buffer once per frame
+		enum class BufferLayout
+		{
+			linear,
+			blocked
+		};
+		BufferLayout m_BufferLayout{ BufferLayout::blocked };
+		int m_BufferWidth{};
+		int m_BufferHeight{};
+		uint32_t* m_pColorBufferPixels{};
 		float* m_pDepthBufferPixels{};
 
 		Texture* m_pTexture{};
-		Texture* m_pNormals{};
-		Texture* m_pSpecular{};
-		Texture* m_pPhongExponent{};
+		//Normal map, specular and gloss packed into one texture, see Texture::CreatePackedMaterial
+		Texture* m_pMaterial{};
 
 		Mesh_PosTexSoftwareVehicle* m_pMesh{};
 
+		//Multithreading
+		ThreadPool* m_pThreadPool{};
+
+		//Screen is split in tiles, every tile is rasterized by one thread so it owns its part of the buffers
+		static constexpr int m_TileSize{ 64 };
+		int m_NumTilesX{};
+		int m_NumTilesY{};
+
+		//Triangle setup, everything that is constant over a triangle is computed once in AssembleTriangle
+		struct Triangle
+		{
+			//Raster space vertices, the attributes are already divided by w for perspective correct interpolation
+			Vertex_Out v0;
+			Vertex_Out v1;
+			Vertex_Out v2;
+
+			//Edge functions E(x, y) = a * (x - originX) + b * (y - originY), edge i lies opposite to vertex i
+			//so E[i] * invArea is the barycentric weight of vertex i
+			//Coverage uses the fixed point version, biased by the top-left rule, the float version gives the weights
+			int32_t fixedEdgeA[3];
+			int32_t fixedEdgeB[3];
+			int32_t fixedEdgeOriginX[3];
+			int32_t fixedEdgeOriginY[3];
+			int32_t fixedEdgeBias[3];
+
+			//Evaluating relative to the edge's start vertex keeps the values small and precise
+			float edgeA[3];
+			float edgeB[3];
+			float edgeOriginX[3];
+			float edgeOriginY[3];
+			float invArea;
+
+			float z[3];
+			float invW[3];
+
+			//Change of uv / w and 1 / w per pixel in x and y, gives the uv derivatives for the mip level
+			float uOverWGradient[2];
+			float vOverWGradient[2];
+			float invWGradient[2];
+
+			//Nearest vertex depth, the interpolated depth is never closer than this
+			float minZ;
+
+			//Pixels whose centre lies within the vertices' bounds, clamped to the screen, max is exclusive
+			int minX;
+			int minY;
+			int maxX;
+			int maxY;
+		};
+		std::vector<Triangle> m_Triangles{};
+
+		//Triangles rejected at setup, assembly runs on one thread
+		struct CullStats
+		{
+			uint32_t backFacing;
+			uint32_t frontFacing;
+			uint32_t degenerate;
+			uint32_t subPixel; //covers no sample point
+		};
+		CullStats m_CullStats{};
+
+		//Clipping, one outcode bit per clip space plane
+		//Triangles that cross the screen edges but stay inside the guard band are rasterized with a clamped bounding box
+		//The outcodes are computed by the vertex kernels
+		static constexpr uint32_t m_ClipLeft{ VertexKernels::ClipLeft };
+		static constexpr uint32_t m_ClipRight{ VertexKernels::ClipRight };
+		static constexpr uint32_t m_ClipBottom{ VertexKernels::ClipBottom };
+		static constexpr uint32_t m_ClipTop{ VertexKernels::ClipTop };
+		static constexpr uint32_t m_ClipNear{ VertexKernels::ClipNear };
+		static constexpr uint32_t m_ClipFar{ VertexKernels::ClipFar };
+		static constexpr uint32_t m_ClipGuardLeft{ VertexKernels::ClipGuardLeft };
+		static constexpr uint32_t m_ClipGuardRight{ VertexKernels::ClipGuardRight };
+		static constexpr uint32_t m_ClipGuardBottom{ VertexKernels::ClipGuardBottom };
+		static constexpr uint32_t m_ClipGuardTop{ VertexKernels::ClipGuardTop };
+		//Planes that really get clipped against, the far plane is handled by the per pixel depth range test
+		static constexpr uint32_t m_ClipPlanesMask{ VertexKernels::ClipPlanesMask };
+		//Guard band size in NDC, 4 screens wide and high
+		static constexpr float m_GuardBand{ VertexKernels::GuardBand };
+
+		//Raster positions are snapped to 28.4 fixed point
+		static constexpr int32_t m_SubPixelBits{ VertexKernels::SubPixelBits };
+		static constexpr int32_t m_SubPixelSteps{ VertexKernels::SubPixelSteps };
+		std::vector<std::vector<uint32_t>> m_TileBins{};
+
+		//Hierarchical depth: the max depth of every 8x8 block and of every tile, the blocks are the ones of the buffer layout
+		//A triangle whose nearest depth lies behind that max can't pass a single depth test in there
+		static constexpr int m_HiZBlockSize{ 8 };
+		int m_NumHiZBlocksX{};
+		int m_NumHiZBlocksY{};
+		float* m_pHiZBlocks{};
+		float* m_pHiZTiles{};
+
+		//Counters per tile, every tile is written by one thread and summed when printed
+		struct RasterStats
+		{
+			uint32_t testedTriangles;
+			uint32_t rejectedTriangles; //whole triangle rejected for the tile
+			uint32_t testedBlocks;
+			uint32_t rejectedBlocks;
+			uint32_t shadedFragments; //or written to the visibility buffer
+		};
+		std::vector<RasterStats> m_TileStats{};
+
+		//Visibility buffer, the raster pass only stores which triangle is visible and where
+		//Shading runs once per pixel afterwards instead of once per fragment that passes the depth test
+		struct VisibilitySample
+		{
+			uint32_t triangleIndex;
+			float weight[3];
+			float depth;
+		};
+		static constexpr uint32_t m_InvalidTriangleIndex{ UINT32_MAX };
+		static constexpr VisibilitySample m_EmptyVisibilitySample{ m_InvalidTriangleIndex, { 0.f, 0.f, 0.f }, 0.f };
+		VisibilitySample* m_pVisibilityBuffer{};
+		bool m_UsingVisibilityBuffer{ false };
+
+		//Depth prepass, every tile first fills its depth buffer with the depth only kernel
+		//The colour pass then only shades the fragments whose depth equals the stored one, so nothing gets shaded twice
+		//Where the nearest fragment fails the uv range check the pixel keeps the clear colour, forward rendering keeps a fragment behind it
+		bool m_UsingDepthPrepass{ false };
+
+		enum class RasterPass
+		{
+			color,		//depth test less or equal, shades or fills the visibility buffer
+			depthOnly,	//only fills the depth buffer
+			colorEqual	//after a depth prepass, depth test equal without writing
+		};
+
+		uint32_t m_ClearColorPacked{};
+
+		//Coverage and depth test kernels, picked at runtime from the supported instruction sets
+		const RasterKernels::KernelSet* m_pRasterKernels{ &RasterKernels::GetScalarKernels() };
+
+		//Vertex transform kernels, vertices are transformed in batches that are spread over the threads
+		const VertexKernels::KernelSet* m_pVertexKernels{ &VertexKernels::GetScalarKernels() };
+		static constexpr int m_VertexBatchSize{ 1024 };
+
 		ColorRGB m_ClearColor{ 99, 99, 99 }; //99 / 255 = 0.36
 
 		enum class RenderState
@@ -80,6 +281,85 @@ namespace dae
 
 		bool m_UsingNormalMap{ true };
 
+		//Texture filter of the software sampler, the level of detail comes from the uv derivatives of every pixel
+		Texture::Filter m_SampleFilter{ Texture::Filter::point };
+
+		//How the Phong specular raises cos alpha to the gloss exponent
+		//fastPow is FastPow, a few multiplies per lane instead of a powf call, see MathHelpers.h for its error
+		enum class SpecularMode
+		{
+			exact,
+			fastPow
+		};
+		SpecularMode m_SpecularMode{ SpecularMode::exact };
+
+		//Space the normals are lit in, object moves the light and camera into the mesh's space instead of every vertex to world space
+		enum class LightingSpace
+		{
+			world,
+			object
+		};
+		LightingSpace m_LightingSpace{ LightingSpace::world };
+
+		//How the interpolated vectors are normalized, fastRSqrt only normalizes the lit normal per block, with FastRSqrt
+		enum class NormalizeMode
+		{
+			exact,
+			fastRSqrt
+		};
+		NormalizeMode m_NormalizeMode{ NormalizeMode::exact };
+
+		//Pixels are shaded a raster block at a time, one lane per pixel
+		static constexpr int m_ShadingWidth{ RasterKernels::BlockWidth };
+		using BlockFloats = Floatx<m_ShadingWidth>;
+		using BlockVectors = Vector3x<m_ShadingWidth>;
+		using BlockColors = ColorRGBx<m_ShadingWidth>;
+		using BlockTexels = Texture::RGBABatch<m_ShadingWidth>;
+		//Interpolated attributes of the pixels of a block, the lanes that aren't shaded hold whatever was there before
+		//With the fast normalization none of the vectors are normalized yet
+		struct ShadingBlock
+		{
+			Vector2x<m_ShadingWidth> uv;
+			BlockVectors normal;
+			BlockVectors tangent;
+			BlockVectors binormal; //only interpolated in object space
+			BlockVectors viewDirection;
+			//Change of the uv over one pixel
+			BlockFloats dudx;
+			BlockFloats dvdx;
+			BlockFloats dudy;
+			BlockFloats dvdy;
+		};
+
+		//What the shading of a render state reads, the pixel kernels leave out everything else
+		static constexpr bool UsesNormal(RenderState state) { return state == RenderState::combined || state == RenderState::observedArea || state == RenderState::phong; }
+		static constexpr bool UsesViewDirection(RenderState state) { return state == RenderState::combined || state == RenderState::phong; }
+		static constexpr bool UsesTextures(RenderState state, bool usingNormalMap) { return state != RenderState::observedArea || usingNormalMap; }
+		static constexpr bool UsesMaterial(RenderState state, bool usingNormalMap) { return UsesViewDirection(state) || (UsesNormal(state) && usingNormalMap); }
+
+		//Pipeline state key, the render state in the low bits and one bit per toggle the per pixel work depends on
+		//Every key gets its own kernels, instantiated from templates so the branches on the state are resolved at compile time
+		//Culling is left out, it is decided once per triangle at setup
+		static constexpr uint32_t m_PipelineStateMask{ 0x7 };
+		static constexpr uint32_t m_PipelineNormalMapBit{ 1u << 3 };
+		static constexpr uint32_t m_PipelineVisibilityBufferBit{ 1u << 4 };
+		static constexpr uint32_t m_PipelineDepthPrepassBit{ 1u << 5 };
+		static constexpr uint32_t m_PipelineFilterShift{ 6 };
+		static constexpr uint32_t m_PipelineFilterMask{ 0x3 << m_PipelineFilterShift };
+		static constexpr uint32_t m_PipelineFastSpecularBit{ 1u << 8 };
+		static constexpr uint32_t m_PipelineObjectSpaceBit{ 1u << 9 };
+		static constexpr uint32_t m_PipelineFastNormalizeBit{ 1u << 10 };
+		static constexpr uint32_t m_NumPipelineKeys{ 1u << 11 };
+
+		using TriangleKernel = void (SoftwareRenderer::*)(uint32_t triangleIndex, int tileIndex, RasterStats& stats) const;
+		using TileKernel = void (SoftwareRenderer::*)(int tileIndex) const;
+		struct DrawKernels
+		{
+			TriangleKernel pDepthPass;	//depth only pass over all triangles of a tile, before the colour pass
+			TriangleKernel pColorPass;
+			TileKernel pResolveTile;	//runs once all triangles of a tile are rasterized
+		};
+
 		struct Light
 		{
 			Vector3 direction;
@@ -87,15 +367,96 @@ namespace dae
 			ColorRGB ambientColor;
 		};
 		const Light m_Light{ Vector3{.577f, -.577f, .577f}.Normalized(), 7.f, ColorRGB{.025f, .025f, .025f}};
+		//m_Light's direction in the space the current frame is lit in, set with the vertex transform
+		Vector3 m_ShadingLightDirection{ m_Light.direction };
+
+		//Lighting in object space only looks the same as in world space when the world matrix keeps angles
+		bool UsesObjectSpaceLighting() const;
+
+		//Colour differences in 8 bit steps over the pixels the mesh covers
+		struct ColorDifference
+		{
+			int coveredPixels;
+			int differingPixels;
+			int maxDifference;
+			float meanDifference;
+		};
+		//Compares the colour buffer against a copy of an earlier frame, the benchmarks use it to compare two modes
+		ColorDifference CompareColorBuffer(const std::vector<uint32_t>& referenceColors) const;
+		//Times RenderMesh with mode set to referenceMode and then to testMode and compares their frames, the caller locks the back buffer and restores mode
+		struct ModeComparison
+		{
+			float referenceTime;	//ms per frame
+			float testTime;			//ms per frame
+			ColorDifference difference;
+		};
+		template<typename Mode>
+		ModeComparison CompareModes(int numFrames, Mode& mode, Mode referenceMode, Mode testMode);
+		//Runs operation on every block a few times and returns the fastest run in ns per lane
+		template<typename Operation>
+		static float TimeBlocks(int numBlocks, Operation operation);
 
 		//Function that transforms the vertices from the mesh from World space to Screen space
-		void VertexTransformationFunction(const std::vector<Vertex_PosTex>& vertices_in, std::vector<Vertex_Out>& vertices_out, const Matrix& meshWorldMatrix); //W3 Version
+		void VertexTransformationFunction(const VertexStreams& vertices_in, std::vector<Vertex_Out>& vertices_out, std::vector<Vertex_Raster>& rasterVertices_out, const Matrix& meshWorldMatrix);
+		//One vertex at a time from the mesh's AoS vertices, kept as the reference for the batched version
+		void VertexTransformationReference(std::span<const Vertex_PosTex> vertices_in, std::vector<Vertex_Out>& vertices_out, std::vector<Vertex_Raster>& rasterVertices_out, const Matrix& meshWorldMatrix) const; //W3 Version
 
-		void RenderTriangle(const Vertex_Out& v0, const Vertex_Out& v1, const Vertex_Out& v2) const; //W4
+		uint32_t GetPipelineKey() const;
+		template<uint32_t PipelineKey>
+		static constexpr DrawKernels CreateDrawKernels();
+		static const DrawKernels& SelectDrawKernels(uint32_t pipelineKey);
+
+		template<RasterPass Pass, RenderState State, bool UsingNormalMap, Texture::Filter Filter, SpecularMode Specular, LightingSpace Space, NormalizeMode Normalize, bool UsingVisibilityBuffer>
+		void RenderTriangle(uint32_t triangleIndex, int tileIndex, RasterStats& stats) const; //W4
+		void RenderTriangleBoundingBox(uint32_t triangleIndex, int tileIndex, RasterStats& stats) const;
+		//Perspective correct w and uv of a fragment, false when the uv falls outside of the texture
+		bool InterpolateUV(const Triangle& triangle, float weight0, float weight1, float weight2, float& interpolatedWDepth, Vector2& interpolatedUV) const;
+		//Interpolates what the render state reads into one lane of the block
+		template<RenderState State, bool UsingNormalMap, LightingSpace Space, NormalizeMode Normalize>
+		void InterpolatePixel(const Triangle& triangle, float weight0, float weight1, float weight2, float interpolatedWDepth, const Vector2& interpolatedUV, int lane, ShadingBlock& pixels) const;
+		//Shades the lanes set in laneMask and writes them to the block starting at blockX
+		template<RenderState State, bool UsingNormalMap, Texture::Filter Filter, SpecularMode Specular, LightingSpace Space, NormalizeMode Normalize>
+		void ShadeBlock(const ShadingBlock& pixels, uint32_t laneMask, int blockX, int py) const;
 		//=========
 
 		void RenderMesh(); //Vehicle
-		ColorRGB PixelShading(const Vertex_Out& vertex) const;
-		ColorRGB Phong(float specular, float exp, const Vector3& l, const Vector3& v, const Vector3& n) const;
+		//Takes indices into the mesh's transformed vertices, rejects, clips and sets up the triangle
+		void AssembleTriangle(uint32_t index0, uint32_t index1, uint32_t index2);
+		void ClipTriangle(uint32_t index0, uint32_t index1, uint32_t index2, uint32_t clipPlanes);
+		void SetupTriangle(uint32_t index0, uint32_t index1, uint32_t index2);
+		Vertex_Raster ToRasterVertex(const Vector4& clipPosition) const;
+		Vertex_Raster ToClippedRasterVertex(const Vector4& clipPosition) const;
+		//Signed distance to one of the clip planes, positive is inside
+		float GetClipDistance(const Vector4& position, uint32_t plane) const;
+		void BinTriangles();
+		void RenderTile(int tileIndex, const DrawKernels& drawKernels, RasterStats& stats) const;
+		template<RenderState State, bool UsingNormalMap, Texture::Filter Filter, SpecularMode Specular, LightingSpace Space, NormalizeMode Normalize>
+		void ResolveVisibilityTile(int tileIndex) const;
+		//Depth visualisation straight from the depth buffer after a depth only pass
+		void ShadeDepthTile(int tileIndex) const;
+		float ComputeBlockMaxDepth(int blockX, int blockY) const;
+		float ComputeTileMaxDepth(int tileIndex) const;
+		void GetTileBounds(int tileIndex, int& minX, int& minY, int& maxX, int& maxY) const;
+		//Allocates the buffers for a screen of the given size, the pixels of a block row are contiguous in both layouts
+		void CreateBuffers(int width, int height);
+		void DeleteBuffers();
+		//Converts the colour buffer to row-major pixels with the given pitch in pixels
+		void ResolveColorBuffer(uint32_t* pPixels, int pitch) const;
+		int GetPixelIndex(int px, int py) const
+		{
+			if (m_BufferLayout == BufferLayout::linear) return px + py * m_BufferWidth;
+
+			constexpr int blockPixels{ m_HiZBlockSize * m_HiZBlockSize };
+			const int blockIndex{ px / m_HiZBlockSize + (py / m_HiZBlockSize) * m_NumHiZBlocksX };
+			return blockIndex * blockPixels + (py % m_HiZBlockSize) * m_HiZBlockSize + px % m_HiZBlockSize;
+		};
+		template<RenderState State, bool UsingNormalMap, Texture::Filter Filter, SpecularMode Specular, LightingSpace Space, NormalizeMode Normalize>
+		BlockColors PixelShading(const ShadingBlock& pixels, uint32_t laneMask) const;
+		template<Texture::Filter Filter>
+		static BlockColors SampleTexture(const Texture* pTexture, const ShadingBlock& pixels, uint32_t laneMask);
+		template<Texture::Filter Filter>
+		static BlockTexels SampleTextureRGBA(const Texture* pTexture, const ShadingBlock& pixels, uint32_t laneMask);
+		template<SpecularMode Specular>
+		BlockColors Phong(const BlockFloats& specular, const BlockFloats& exp, const Vector3& l, const BlockVectors& v, const BlockVectors& n) const;
 	};
 }
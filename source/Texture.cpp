@@ -2,12 +2,77 @@
 #include "Texture.h"
 #include "Vector2.h"
 #include <SDL_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <immintrin.h>
 
 namespace dae
 {
+	namespace
+	{
+		//Channels of an RGBA8 texel, still in the 0 to 255 range
+		Texture::RGBA UnpackTexel(uint32_t texel)
+		{
+			return Texture::RGBA{ float(texel & 0xFF), float((texel >> 8) & 0xFF), float((texel >> 16) & 0xFF), float(texel >> 24) };
+		}
+
+		Texture::RGBA LerpTexel(const Texture::RGBA& texel1, const Texture::RGBA& texel2, float factor)
+		{
+			return Texture::RGBA{ Lerpf(texel1.r, texel2.r, factor), Lerpf(texel1.g, texel2.g, factor), Lerpf(texel1.b, texel2.b, factor), Lerpf(texel1.a, texel2.a, factor) };
+		}
+
+		Texture::RGBA ScaleTexel(const Texture::RGBA& texel, float scale)
+		{
+			return Texture::RGBA{ texel.r * scale, texel.g * scale, texel.b * scale, texel.a * scale };
+		}
+
+		//Checked once, every batch sample picks its path from it
+		bool HasGathers()
+		{
+			static const bool hasAVX2{ SDL_HasAVX2() == SDL_TRUE };
+			return hasAVX2;
+		}
+
+		//Channels of 8 texels, scaled like the scalar samples
+		struct TexelLanes
+		{
+			__m256 r;
+			__m256 g;
+			__m256 b;
+			__m256 a;
+		};
+
+		TexelLanes UnpackTexels(__m256i texels)
+		{
+			const __m256i channelMask{ _mm256_set1_epi32(0xFF) };
+			return TexelLanes{
+				_mm256_cvtepi32_ps(_mm256_and_si256(texels, channelMask)),
+				_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), channelMask)),
+				_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), channelMask)),
+				_mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24)) };
+		}
+
+		//Same operations as Lerpf, so the lanes round like the scalar samples
+		__m256 LerpLanes(__m256 a, __m256 b, __m256 factor)
+		{
+			return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.f), factor), a), _mm256_mul_ps(factor, b));
+		}
+
+		TexelLanes LerpTexels(const TexelLanes& texels1, const TexelLanes& texels2, __m256 factor)
+		{
+			return TexelLanes{ LerpLanes(texels1.r, texels2.r, factor), LerpLanes(texels1.g, texels2.g, factor), LerpLanes(texels1.b, texels2.b, factor), LerpLanes(texels1.a, texels2.a, factor) };
+		}
+
+		TexelLanes ScaleTexels(const TexelLanes& texels, __m256 scale)
+		{
+			return TexelLanes{ _mm256_mul_ps(texels.r, scale), _mm256_mul_ps(texels.g, scale), _mm256_mul_ps(texels.b, scale), _mm256_mul_ps(texels.a, scale) };
+		}
+	}
+
 	Texture::Texture(SDL_Surface* pSurface, ID3D11Device* pDevice)
-		:m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+		:m_pSurface{ pSurface }
 	{
 		DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		D3D11_TEXTURE2D_DESC desc{};
@@ -45,13 +110,170 @@ namespace dae
 	}
 
 	Texture::Texture(SDL_Surface* pSurface)
-		:m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+		:Texture(pSurface->w, pSurface->h)
 	{
+		//Whatever format the image was loaded in, sampling always reads the same channel order
+		SDL_Surface* pConvertedSurface{ SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+
+		for (int y{}; y < m_Height; ++y)
+		{
+			const uint8_t* pRow{ static_cast<const uint8_t*>(pConvertedSurface->pixels) + static_cast<size_t>(y) * pConvertedSurface->pitch };
+			std::memcpy(m_pTexels + static_cast<size_t>(y) * m_Width, pRow, m_Width * sizeof(uint32_t));
+		}
+
+		SDL_FreeSurface(pConvertedSurface);
+		SDL_FreeSurface(pSurface);
+
+		GenerateMipLevels();
+	}
+
+	Texture::Texture(int width, int height)
+		:m_Width{ width },
+		m_Height{ height }
+	{
+		//Size of every level, a level is half of the previous one rounded down but at least 1 texel
+		size_t numTexels{};
+		int levelWidth{ m_Width };
+		int levelHeight{ m_Height };
+		while (m_NumMipLevels < m_MaxMipLevels)
+		{
+			m_MipLevels[m_NumMipLevels] = MipLevel{ nullptr, levelWidth, levelHeight };
+			numTexels += InitializeLevelLayout(m_Layout, m_MipLevels[m_NumMipLevels]);
+			++m_NumMipLevels;
+
+			if (levelWidth == 1 && levelHeight == 1) break;
+			levelWidth = std::max(levelWidth / 2, 1);
+			levelHeight = std::max(levelHeight / 2, 1);
+		}
+
+		m_pTexels = new (std::align_val_t{ m_TexelAlignment }) uint32_t[numTexels];
+		uint32_t* pLevelTexels{ m_pTexels };
+		for (int level{}; level < m_NumMipLevels; ++level)
+		{
+			m_MipLevels[level].pTexels = pLevelTexels;
+			pLevelTexels += InitializeLevelLayout(m_Layout, m_MipLevels[level]);
+		}
+		UpdateLevelTable();
+	}
+
+	size_t Texture::InitializeLevelLayout(Layout layout, MipLevel& level)
+	{
+		switch (layout)
+		{
+		case Layout::blocked:
+		{
+			level.numBlocksX = (level.width + m_BlockSize - 1) / m_BlockSize;
+			const int numBlocksY{ (level.height + m_BlockSize - 1) / m_BlockSize };
+			return static_cast<size_t>(level.numBlocksX) * numBlocksY * m_BlockSize * m_BlockSize;
+		}
+		case Layout::morton:
+		{
+			const uint32_t paddedWidth{ std::bit_ceil(static_cast<uint32_t>(level.width)) };
+			const uint32_t paddedHeight{ std::bit_ceil(static_cast<uint32_t>(level.height)) };
+			level.mortonBits = std::countr_zero(std::min(paddedWidth, paddedHeight));
+			return static_cast<size_t>(paddedWidth) * paddedHeight;
+		}
+		case Layout::rowMajor:
+		default:
+			return static_cast<size_t>(level.width) * level.height;
+		}
+	}
+
+	void Texture::SetLayout(Layout layout)
+	{
+		if (layout == m_Layout) return;
+
+		MipLevel levels[m_MaxMipLevels]{};
+		size_t numTexels{};
+		for (int level{}; level < m_NumMipLevels; ++level)
+		{
+			levels[level].width = m_MipLevels[level].width;
+			levels[level].height = m_MipLevels[level].height;
+			numTexels += InitializeLevelLayout(layout, levels[level]);
+		}
+
+		uint32_t* pTexels{ new (std::align_val_t{ m_TexelAlignment }) uint32_t[numTexels] };
+		uint32_t* pLevelTexels{ pTexels };
+		for (int level{}; level < m_NumMipLevels; ++level)
+		{
+			levels[level].pTexels = pLevelTexels;
+			pLevelTexels += InitializeLevelLayout(layout, levels[level]);
+
+			const MipLevel& source{ m_MipLevels[level] };
+			const MipLevel& destination{ levels[level] };
+			for (int y{}; y < destination.height; ++y)
+			{
+				for (int x{}; x < destination.width; ++x)
+				{
+					destination.pTexels[GetTexelIndex(layout, destination, x, y)] = source.pTexels[GetTexelIndex(m_Layout, source, x, y)];
+				}
+			}
+		}
+
+		::operator delete[](m_pTexels, std::align_val_t{ m_TexelAlignment });
+		m_pTexels = pTexels;
+		std::copy(std::begin(levels), std::end(levels), std::begin(m_MipLevels));
+		m_Layout = layout;
+		UpdateLevelTable();
+	}
+
+	void Texture::UpdateLevelTable()
+	{
+		for (int level{}; level < m_NumMipLevels; ++level)
+		{
+			m_LevelTable.width[level] = m_MipLevels[level].width;
+			m_LevelTable.height[level] = m_MipLevels[level].height;
+			m_LevelTable.texelOffset[level] = static_cast<int>(m_MipLevels[level].pTexels - m_pTexels);
+			m_LevelTable.numBlocksX[level] = m_MipLevels[level].numBlocksX;
+		}
+	}
+
+	void Texture::GenerateMipLevels()
+	{
+		//Runs at load, while the texels are still row-major
+		for (int level{ 1 }; level < m_NumMipLevels; ++level)
+		{
+			const MipLevel& source{ m_MipLevels[level - 1] };
+			const MipLevel& destination{ m_MipLevels[level] };
+
+			for (int y{}; y < destination.height; ++y)
+			{
+				//Each level halves rounding down, so an odd size drops its last row or column; the clamp only matters when the source is 1 texel wide or high
+				const int sourceY0{ std::min(y * 2, source.height - 1) };
+				const int sourceY1{ std::min(y * 2 + 1, source.height - 1) };
+
+				for (int x{}; x < destination.width; ++x)
+				{
+					const int sourceX0{ std::min(x * 2, source.width - 1) };
+					const int sourceX1{ std::min(x * 2 + 1, source.width - 1) };
+
+					const uint32_t texels[4]{
+						source.pTexels[sourceX0 + sourceY0 * source.width],
+						source.pTexels[sourceX1 + sourceY0 * source.width],
+						source.pTexels[sourceX0 + sourceY1 * source.width],
+						source.pTexels[sourceX1 + sourceY1 * source.width] };
+
+					//Average every channel, rounded to nearest
+					uint32_t texel{};
+					for (int shift{}; shift < 32; shift += 8)
+					{
+						uint32_t sum{ 2 };
+						for (const uint32_t sourceTexel : texels) sum += (sourceTexel >> shift) & 0xFF;
+						texel |= (sum / 4) << shift;
+					}
+					destination.pTexels[x + y * destination.width] = texel;
+				}
+			}
+		}
 	}
 
 	Texture::~Texture()
 	{
+		if (m_pTexels)
+		{
+			::operator delete[](m_pTexels, std::align_val_t{ m_TexelAlignment });
+		}
+
 		if (m_pTexture)
 		{
 			m_pTexture->Release();
@@ -73,18 +295,281 @@ namespace dae
 		return new Texture(IMG_Load(path.c_str()));
 	}
 
+	Texture* Texture::CreatePackedMaterial(const Texture* pNormals, const Texture* pSpecular, const Texture* pGloss)
+	{
+		Texture* pMaterial{ new Texture(pNormals->m_Width, pNormals->m_Height) };
+
+		//The normal map sets the size, the other maps are point sampled at the texel centres in case they differ
+		const auto fetchTexel = [](const Texture* pSource, float u, float v)
+		{
+			const MipLevel& level{ pSource->m_MipLevels[0] };
+			const int x{ std::min(static_cast<int>(level.width * u), level.width - 1) };
+			const int y{ std::min(static_cast<int>(level.height * v), level.height - 1) };
+			return level.pTexels[GetTexelIndex(pSource->m_Layout, level, x, y)];
+		};
+
+		for (int y{}; y < pMaterial->m_Height; ++y)
+		{
+			const float v{ (y + 0.5f) / pMaterial->m_Height };
+			for (int x{}; x < pMaterial->m_Width; ++x)
+			{
+				const float u{ (x + 0.5f) / pMaterial->m_Width };
+				const uint32_t normal{ fetchTexel(pNormals, u, v) };
+				const uint32_t specular{ fetchTexel(pSpecular, u, v) & 0xFF };
+				const uint32_t gloss{ fetchTexel(pGloss, u, v) & 0xFF };
+				pMaterial->m_pTexels[x + y * pMaterial->m_Width] = (normal & 0xFFFF) | (specular << 16) | (gloss << 24);
+			}
+		}
+
+		//The box filter averages every channel on its own, so the packed levels match packing the levels of the sources
+		pMaterial->GenerateMipLevels();
+		return pMaterial;
+	}
+
 	ColorRGB Texture::Sample(const Vector2& uv) const
 	{
-		Uint32 pixelX = Uint32(m_pSurface->w * uv.x);
-		Uint32 pixelY = Uint32(m_pSurface->h * uv.y);
+		const RGBA color{ SamplePoint(m_MipLevels[0], uv.x, uv.y) };
+		return ColorRGB{ color.r, color.g, color.b };
+	}
+
+	float Texture::ComputeLod(float dudx, float dvdx, float dudy, float dvdy) const
+	{
+		//Length of the pixel's larger axis in texels of the full resolution level
+		const float dxTexelsX{ dudx * m_Width };
+		const float dxTexelsY{ dvdx * m_Height };
+		const float dyTexelsX{ dudy * m_Width };
+		const float dyTexelsY{ dvdy * m_Height };
+		const float maxLengthSquared{ std::max(dxTexelsX * dxTexelsX + dxTexelsY * dxTexelsY, dyTexelsX * dyTexelsX + dyTexelsY * dyTexelsY) };
+
+		//log2 of the length, the square root folds into the factor
+		return 0.5f * FastLog2f(maxLengthSquared);
+	}
 
-		Uint32 pixelIndx = pixelX + pixelY * m_pSurface->w;
-		Uint8 r{}, g{}, b{};
-		SDL_GetRGB(m_pSurfacePixels[pixelIndx], m_pSurface->format, &r, &g, &b);
-		ColorRGB texelColor{ float(r), float(g), float(b) };
-		texelColor /= 255.0f;
+	template<Texture::Filter SampleFilter>
+	Texture::RGBA Texture::SampleRGBA(const Vector2& uv, float lod) const
+	{
+		//Magnification stays on the full resolution level, past the last level stays on 1x1
+		const float clampedLod{ std::clamp(lod, 0.f, static_cast<float>(m_NumMipLevels - 1)) };
+
+		if constexpr (SampleFilter == Filter::point)
+		{
+			return SamplePoint(m_MipLevels[static_cast<int>(clampedLod + 0.5f)], uv.x, uv.y);
+		}
+		else if constexpr (SampleFilter == Filter::bilinear)
+		{
+			return SampleBilinear(m_MipLevels[static_cast<int>(clampedLod + 0.5f)], uv.x, uv.y);
+		}
+		else
+		{
+			const int level{ static_cast<int>(clampedLod) };
+			const float levelFactor{ clampedLod - static_cast<float>(level) };
+
+			const RGBA color{ SampleBilinear(m_MipLevels[level], uv.x, uv.y) };
+			if (levelFactor == 0.f) return color;
+			return LerpTexel(color, SampleBilinear(m_MipLevels[level + 1], uv.x, uv.y), levelFactor);
+		}
+	}
+
+	template Texture::RGBA Texture::SampleRGBA<Texture::Filter::point>(const Vector2& uv, float lod) const;
+	template Texture::RGBA Texture::SampleRGBA<Texture::Filter::bilinear>(const Vector2& uv, float lod) const;
+	template Texture::RGBA Texture::SampleRGBA<Texture::Filter::trilinear>(const Vector2& uv, float lod) const;
+
+	template<Texture::Filter SampleFilter>
+	ColorRGB Texture::Sample(const Vector2& uv, float lod) const
+	{
+		const RGBA color{ SampleRGBA<SampleFilter>(uv, lod) };
+		return ColorRGB{ color.r, color.g, color.b };
+	}
+
+	template ColorRGB Texture::Sample<Texture::Filter::point>(const Vector2& uv, float lod) const;
+	template ColorRGB Texture::Sample<Texture::Filter::bilinear>(const Vector2& uv, float lod) const;
+	template ColorRGB Texture::Sample<Texture::Filter::trilinear>(const Vector2& uv, float lod) const;
+
+	template<Texture::Filter SampleFilter>
+	void Texture::Sample4(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<4>& result) const
+	{
+		SampleBatch<SampleFilter, 4>(pU, pV, pLod, laneMask, result);
+	}
+
+	template<Texture::Filter SampleFilter>
+	void Texture::Sample8(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<8>& result) const
+	{
+		SampleBatch<SampleFilter, 8>(pU, pV, pLod, laneMask, result);
+	}
+
+	template void Texture::Sample4<Texture::Filter::point>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<4>& result) const;
+	template void Texture::Sample4<Texture::Filter::bilinear>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<4>& result) const;
+	template void Texture::Sample4<Texture::Filter::trilinear>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<4>& result) const;
+	template void Texture::Sample8<Texture::Filter::point>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<8>& result) const;
+	template void Texture::Sample8<Texture::Filter::bilinear>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<8>& result) const;
+	template void Texture::Sample8<Texture::Filter::trilinear>(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<8>& result) const;
+
+	template<Texture::Filter SampleFilter, int Width>
+	void Texture::SampleBatch(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<Width>& result) const
+	{
+		//Morton indices need the bit interleave per lane, those textures take the scalar path
+		if (m_Layout != Layout::morton && HasGathers())
+		{
+			SampleBatchAVX2<SampleFilter, Width>(pU, pV, pLod, laneMask, result);
+			return;
+		}
+
+		for (int lane{}; lane < Width; ++lane)
+		{
+			RGBA color{};
+			if (laneMask & (1u << lane))
+			{
+				color = SampleRGBA<SampleFilter>(Vector2{ pU[lane], pV[lane] }, pLod[lane]);
+			}
+			result.r[lane] = color.r;
+			result.g[lane] = color.g;
+			result.b[lane] = color.b;
+			result.a[lane] = color.a;
+		}
+	}
+
+	template<Texture::Filter SampleFilter, int Width>
+	void Texture::SampleBatchAVX2(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<Width>& result) const
+	{
+		static_assert(Width == 4 || Width == 8, "Batches are 4 or 8 lanes");
+
+		//4 lanes run in the lower half, the upper half is masked off
+		const __m256i laneBits{ _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128) };
+		const __m256i lanes{ _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(laneMask & ((1u << Width) - 1))), laneBits), laneBits) };
+		const auto load = [&lanes](const float* pValues)
+		{
+			__m256 values{};
+			if constexpr (Width == 8) values = _mm256_loadu_ps(pValues);
+			else values = _mm256_castps128_ps256(_mm_loadu_ps(pValues));
+			//Lanes outside the mask sample texel 0 of level 0, whatever the caller left in them
+			return _mm256_and_ps(values, _mm256_castsi256_ps(lanes));
+		};
+		const __m256 u{ load(pU) };
+		const __m256 v{ load(pV) };
+		const __m256 lod{ load(pLod) };
+
+		const __m256i one{ _mm256_set1_epi32(1) };
+		const __m256i zero{ _mm256_setzero_si256() };
+		const __m256 invMaxChannel{ _mm256_set1_ps(m_InvMaxChannel) };
+		const __m256 clampedLod{ _mm256_min_ps(_mm256_max_ps(lod, _mm256_setzero_ps()), _mm256_set1_ps(static_cast<float>(m_NumMipLevels - 1))) };
+
+		const auto fetchTexels = [this](__m256i x, __m256i y, __m256i width, __m256i levelIndex)
+		{
+			__m256i index{};
+			if (m_Layout == Layout::blocked)
+			{
+				//Same as GetTexelIndex, the block size is 4
+				const __m256i numBlocksX{ _mm256_i32gather_epi32(m_LevelTable.numBlocksX, levelIndex, 4) };
+				const __m256i blockIndex{ _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, 2), numBlocksX), _mm256_srli_epi32(x, 2)) };
+				const __m256i blockMask{ _mm256_set1_epi32(m_BlockSize - 1) };
+				index = _mm256_add_epi32(_mm256_slli_epi32(blockIndex, 4), _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, blockMask), 2), _mm256_and_si256(x, blockMask)));
+			}
+			else
+			{
+				index = _mm256_add_epi32(x, _mm256_mullo_epi32(y, width));
+			}
+			const __m256i texelOffset{ _mm256_i32gather_epi32(m_LevelTable.texelOffset, levelIndex, 4) };
+			return UnpackTexels(_mm256_i32gather_epi32(reinterpret_cast<const int*>(m_pTexels), _mm256_add_epi32(texelOffset, index), 4));
+		};
+
+		const auto samplePoint = [&](__m256i levelIndex)
+		{
+			const __m256i width{ _mm256_i32gather_epi32(m_LevelTable.width, levelIndex, 4) };
+			const __m256i height{ _mm256_i32gather_epi32(m_LevelTable.height, levelIndex, 4) };
+			const __m256i x{ _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(width), u)), _mm256_sub_epi32(width, one)) };
+			const __m256i y{ _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(height), v)), _mm256_sub_epi32(height, one)) };
+			return ScaleTexels(fetchTexels(x, y, width, levelIndex), invMaxChannel);
+		};
+
+		const auto sampleBilinear = [&](__m256i levelIndex)
+		{
+			const __m256i width{ _mm256_i32gather_epi32(m_LevelTable.width, levelIndex, 4) };
+			const __m256i height{ _mm256_i32gather_epi32(m_LevelTable.height, levelIndex, 4) };
+			const __m256 x{ _mm256_sub_ps(_mm256_mul_ps(u, _mm256_cvtepi32_ps(width)), _mm256_set1_ps(0.5f)) };
+			const __m256 y{ _mm256_sub_ps(_mm256_mul_ps(v, _mm256_cvtepi32_ps(height)), _mm256_set1_ps(0.5f)) };
+			const __m256 floorX{ _mm256_floor_ps(x) };
+			const __m256 floorY{ _mm256_floor_ps(y) };
+			const __m256 factorX{ _mm256_sub_ps(x, floorX) };
+			const __m256 factorY{ _mm256_sub_ps(y, floorY) };
+
+			const __m256i maxX{ _mm256_sub_epi32(width, one) };
+			const __m256i maxY{ _mm256_sub_epi32(height, one) };
+			const __m256i floorXi{ _mm256_cvttps_epi32(floorX) };
+			const __m256i floorYi{ _mm256_cvttps_epi32(floorY) };
+			const __m256i x0{ _mm256_min_epi32(_mm256_max_epi32(floorXi, zero), maxX) };
+			const __m256i x1{ _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(floorXi, one), zero), maxX) };
+			const __m256i y0{ _mm256_min_epi32(_mm256_max_epi32(floorYi, zero), maxY) };
+			const __m256i y1{ _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(floorYi, one), zero), maxY) };
+
+			const TexelLanes top{ LerpTexels(fetchTexels(x0, y0, width, levelIndex), fetchTexels(x1, y0, width, levelIndex), factorX) };
+			const TexelLanes bottom{ LerpTexels(fetchTexels(x0, y1, width, levelIndex), fetchTexels(x1, y1, width, levelIndex), factorX) };
+			return ScaleTexels(LerpTexels(top, bottom, factorY), invMaxChannel);
+		};
+
+		TexelLanes color{};
+		if constexpr (SampleFilter == Filter::point)
+		{
+			color = samplePoint(_mm256_cvttps_epi32(_mm256_add_ps(clampedLod, _mm256_set1_ps(0.5f))));
+		}
+		else if constexpr (SampleFilter == Filter::bilinear)
+		{
+			color = sampleBilinear(_mm256_cvttps_epi32(_mm256_add_ps(clampedLod, _mm256_set1_ps(0.5f))));
+		}
+		else
+		{
+			const __m256i level{ _mm256_cvttps_epi32(clampedLod) };
+			const __m256 levelFactor{ _mm256_sub_ps(clampedLod, _mm256_cvtepi32_ps(level)) };
+
+			color = sampleBilinear(level);
+			//A factor of 0 keeps the first level exactly, like the scalar early out
+			if (!_mm256_testz_ps(_mm256_cmp_ps(levelFactor, _mm256_setzero_ps(), _CMP_NEQ_UQ), _mm256_castsi256_ps(lanes)))
+			{
+				const __m256i nextLevel{ _mm256_min_epi32(_mm256_add_epi32(level, one), _mm256_set1_epi32(m_NumMipLevels - 1)) };
+				color = LerpTexels(color, sampleBilinear(nextLevel), levelFactor);
+			}
+		}
+
+		const auto store = [&lanes](float* pValues, __m256 values)
+		{
+			values = _mm256_and_ps(values, _mm256_castsi256_ps(lanes));
+			if constexpr (Width == 8) _mm256_storeu_ps(pValues, values);
+			else _mm_storeu_ps(pValues, _mm256_castps256_ps128(values));
+		};
+		store(result.r, color.r);
+		store(result.g, color.g);
+		store(result.b, color.b);
+		store(result.a, color.a);
+	}
+
+	Texture::RGBA Texture::SamplePoint(const MipLevel& level, float u, float v) const
+	{
+		//uv == 1 would be one texel past the edge, it belongs to the last texel
+		const int pixelX{ std::min(static_cast<int>(level.width * u), level.width - 1) };
+		const int pixelY{ std::min(static_cast<int>(level.height * v), level.height - 1) };
 
 		//Sample the correct texel for the given uv
-		return texelColor;
+		return ScaleTexel(UnpackTexel(level.pTexels[GetTexelIndex(m_Layout, level, pixelX, pixelY)]), m_InvMaxChannel);
+	}
+
+	Texture::RGBA Texture::SampleBilinear(const MipLevel& level, float u, float v) const
+	{
+		//Texel centres lie at half texels, the four around the sample point are blended
+		//Coordinates are clamped to the edge, the uv never leaves 0 to 1 in the software renderer
+		const float x{ u * level.width - 0.5f };
+		const float y{ v * level.height - 0.5f };
+		const float floorX{ std::floor(x) };
+		const float floorY{ std::floor(y) };
+		const float factorX{ x - floorX };
+		const float factorY{ y - floorY };
+
+		const int x0{ std::clamp(static_cast<int>(floorX), 0, level.width - 1) };
+		const int x1{ std::clamp(static_cast<int>(floorX) + 1, 0, level.width - 1) };
+		const int y0{ std::clamp(static_cast<int>(floorY), 0, level.height - 1) };
+		const int y1{ std::clamp(static_cast<int>(floorY) + 1, 0, level.height - 1) };
+
+		const uint32_t* pTexels{ level.pTexels };
+		const RGBA top{ LerpTexel(UnpackTexel(pTexels[GetTexelIndex(m_Layout, level, x0, y0)]), UnpackTexel(pTexels[GetTexelIndex(m_Layout, level, x1, y0)]), factorX) };
+		const RGBA bottom{ LerpTexel(UnpackTexel(pTexels[GetTexelIndex(m_Layout, level, x0, y1)]), UnpackTexel(pTexels[GetTexelIndex(m_Layout, level, x1, y1)]), factorX) };
+		return ScaleTexel(LerpTexel(top, bottom, factorY), m_InvMaxChannel);
 	}
 }
\ No newline at end of file
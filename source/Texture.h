@@ -1,5 +1,6 @@
 #pragma once
 #include <SDL_surface.h>
+#include <cstdint>
 #include <string>
 #include "ColorRGB.h"
 
@@ -13,16 +14,163 @@ namespace dae
 		~Texture();
 		static 	Texture* LoadFromFile(const std::string& path, ID3D11Device* pDevice);
 		static 	Texture* LoadFromFile(const std::string& path);
+		//Packs the maps that are only read together into one software texture, so shading fetches them at once
+		//R and G hold the tangent space normal's x and y, B the specular and A the gloss, each from its map's red channel
+		//z is rebuilt from x and y when sampling, the sources are left untouched and can be deleted afterwards
+		static Texture* CreatePackedMaterial(const Texture* pNormals, const Texture* pSpecular, const Texture* pGloss);
+		//Point sample of the full resolution level
 		ColorRGB Sample(const Vector2& uv) const;
+
+		//Software filters, the same ones the hardware sampler states cycle through
+		//Point and bilinear use the nearest mip level, trilinear blends the two levels around the lod
+		enum class Filter
+		{
+			point,
+			bilinear,
+			trilinear
+		};
+		//Level of detail from the change of uv over one pixel in x and in y, 0 is the full resolution level
+		float ComputeLod(float dudx, float dvdx, float dudy, float dvdy) const;
+		template<Filter SampleFilter>
+		ColorRGB Sample(const Vector2& uv, float lod) const;
+		//All four channels, for textures that pack more than a colour
+		struct RGBA
+		{
+			float r;
+			float g;
+			float b;
+			float a;
+		};
+		template<Filter SampleFilter>
+		RGBA SampleRGBA(const Vector2& uv, float lod) const;
+
+		//Colours of a batch of lanes, structure of arrays
+		template<int Width>
+		struct RGBABatch
+		{
+			float r[Width];
+			float g[Width];
+			float b[Width];
+			float a[Width];
+		};
+		//Samples a batch of lanes at once, uv and lod are structure of arrays like the result
+		//Only the lanes set in laneMask are sampled, the others return 0, every sampled lane matches SampleRGBA exactly
+		//Gathers on AVX2, one lane at a time on other CPUs and for the Morton layout
+		template<Filter SampleFilter>
+		void Sample4(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<4>& result) const;
+		template<Filter SampleFilter>
+		void Sample8(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<8>& result) const;
+		int GetNumMipLevels() const { return m_NumMipLevels; }
+
+		//Order of the software texels in memory
+		//Row-major keeps every row contiguous, so steps along v miss the cache
+		//Blocked stores every 4x4 block contiguously, Morton orders the texels along a Z-order curve
+		//so texels that are close in both u and v are close in memory
+		enum class Layout
+		{
+			rowMajor,
+			blocked,
+			morton
+		};
+		//Rearranges the texels of every level, only meant for load time
+		void SetLayout(Layout layout);
+		Layout GetLayout() const { return m_Layout; }
+
+
 		ID3D11ShaderResourceView* GetSRV() const { return m_pShaderResourceView; }
 
 	private:
 		Texture(SDL_Surface* pSurface, ID3D11Device* pDevice);
 		Texture(SDL_Surface* pSurface);
-		
+		//Allocates the mip chain of a software texture, the texels are left for the caller to fill
+		Texture(int width, int height);
+
 
 		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+
+		//Software texels, decoded once at load as RGBA8 with red in the lowest byte
+		//The rows are tightly packed and the array starts on a cache line
+		static constexpr size_t m_TexelAlignment{ 64 };
+		static constexpr float m_InvMaxChannel{ 1.f / 255.f };
+		uint32_t* m_pTexels{ nullptr };
+		int m_Width{};
+		int m_Height{};
+
+		//Mip chain, every level halves the previous one with a 2x2 box filter down to 1x1
+		//All levels live in m_pTexels, one after the other
+		struct MipLevel
+		{
+			uint32_t* pTexels;
+			int width;
+			int height;
+			int numBlocksX;		//blocked, padded to whole blocks
+			int mortonBits;		//Morton, padded to powers of two, the bits of the smaller side get interleaved
+		};
+		static constexpr int m_MaxMipLevels{ 16 };
+		MipLevel m_MipLevels[m_MaxMipLevels]{};
+		int m_NumMipLevels{};
+
+		static constexpr int m_BlockSize{ 4 };
+		Layout m_Layout{ Layout::rowMajor };
+
+		//The level values the batch sampler gathers by level index, kept in sync with m_MipLevels
+		struct LevelTable
+		{
+			int width[m_MaxMipLevels];
+			int height[m_MaxMipLevels];
+			int texelOffset[m_MaxMipLevels];	//from m_pTexels
+			int numBlocksX[m_MaxMipLevels];
+		};
+		LevelTable m_LevelTable{};
+		void UpdateLevelTable();
+
+		//Fills in the layout specific sizes of the level and returns the amount of texels it takes
+		static size_t InitializeLevelLayout(Layout layout, MipLevel& level);
+
+		//Spreads the bits of x over the even bits and the bits of y over the odd bits
+		static uint32_t InterleaveBits(uint32_t x, uint32_t y)
+		{
+			uint32_t bits[2]{ x, y };
+			for (uint32_t& value : bits)
+			{
+				value = (value | (value << 8)) & 0x00FF00FF;
+				value = (value | (value << 4)) & 0x0F0F0F0F;
+				value = (value | (value << 2)) & 0x33333333;
+				value = (value | (value << 1)) & 0x55555555;
+			}
+			return bits[0] | (bits[1] << 1);
+		}
+
+		static int GetTexelIndex(Layout layout, const MipLevel& level, int x, int y)
+		{
+			switch (layout)
+			{
+			case Layout::blocked:
+			{
+				//Texel coordinates are never negative, unsigned keeps the divisions shifts
+				const uint32_t blockIndex{ (static_cast<uint32_t>(y) / m_BlockSize) * level.numBlocksX + static_cast<uint32_t>(x) / m_BlockSize };
+				return static_cast<int>(blockIndex * m_BlockSize * m_BlockSize + (static_cast<uint32_t>(y) % m_BlockSize) * m_BlockSize + static_cast<uint32_t>(x) % m_BlockSize);
+			}
+			case Layout::morton:
+			{
+				//Past the square part only one of the two has bits left, those pick the square
+				const uint32_t mask{ (1u << level.mortonBits) - 1 };
+				const uint32_t square{ static_cast<uint32_t>(x | y) >> level.mortonBits };
+				return static_cast<int>(InterleaveBits(x & mask, y & mask) | (square << (2 * level.mortonBits)));
+			}
+			case Layout::rowMajor:
+			default:
+				return x + y * level.width;
+			}
+		}
+
+		void GenerateMipLevels();
+		RGBA SamplePoint(const MipLevel& level, float u, float v) const;
+		RGBA SampleBilinear(const MipLevel& level, float u, float v) const;
+		template<Filter SampleFilter, int Width>
+		void SampleBatch(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<Width>& result) const;
+		template<Filter SampleFilter, int Width>
+		void SampleBatchAVX2(const float* pU, const float* pV, const float* pLod, uint32_t laneMask, RGBABatch<Width>& result) const;
 		ID3D11ShaderResourceView* m_pShaderResourceView{ nullptr };
 		ID3D11Texture2D* m_pTexture{ nullptr };
 	};
@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	ThreadPool::ThreadPool(int numThreads)
+	{
+		StartWorkers(std::max(numThreads, 1) - 1);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		StopWorkers();
+	}
+
+	void ThreadPool::SetNumThreads(int numThreads)
+	{
+		numThreads = std::max(numThreads, 1);
+		if (numThreads == GetNumThreads()) return;
+
+		StopWorkers();
+		StartWorkers(numThreads - 1);
+	}
+
+	void ThreadPool::Dispatch(int count, JobFunction pJob, const void* pContext)
+	{
+		if (count <= 0) return;
+
+		//Nothing to share the work with, skip the synchronisation entirely
+		if (m_Workers.empty() || count == 1)
+		{
+			for (int i{}; i < count; ++i)
+			{
+				pJob(pContext, i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_pJob = pJob;
+			m_pJobContext = pContext;
+			m_JobCount = count;
+			m_NextJob.store(0, std::memory_order_relaxed);
+			m_BusyWorkers = static_cast<int>(m_Workers.size());
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		RunJobs();
+
+		//Wait until every worker left the job, the context lives on the caller's stack
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this]() { return m_BusyWorkers == 0; });
+		m_pJob = nullptr;
+		m_pJobContext = nullptr;
+	}
+
+	void ThreadPool::RunJobs()
+	{
+		for (int index{ m_NextJob.fetch_add(1, std::memory_order_relaxed) }; index < m_JobCount; index = m_NextJob.fetch_add(1, std::memory_order_relaxed))
+		{
+			m_pJob(m_pJobContext, index);
+		}
+	}
+
+	void ThreadPool::WorkerLoop(uint64_t lastGeneration)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [&]() { return m_IsQuitting || m_Generation != lastGeneration; });
+				if (m_IsQuitting) return;
+				lastGeneration = m_Generation;
+			}
+
+			RunJobs();
+
+			{
+				std::lock_guard<std::mutex> lock{ m_Mutex };
+				--m_BusyWorkers;
+			}
+			m_DoneCondition.notify_one();
+		}
+	}
+
+	void ThreadPool::StartWorkers(int numWorkers)
+	{
+		m_IsQuitting = false;
+		m_Workers.reserve(numWorkers);
+		for (int i{}; i < numWorkers; ++i)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, m_Generation);
+		}
+	}
+
+	void ThreadPool::StopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_IsQuitting = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+		m_Workers.clear();
+	}
+}
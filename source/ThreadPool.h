@@ -0,0 +1,68 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Persistent worker threads that split an index range between them.
+	//The calling thread also takes jobs, so a pool of N threads spawns N - 1 workers.
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(int numThreads);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		void SetNumThreads(int numThreads);
+		int GetNumThreads() const { return static_cast<int>(m_Workers.size()) + 1; };
+
+		//Calls func(index) for every index in [0, count) and returns once all of them are done
+		//The callable is passed by pointer, so dispatching never allocates
+		template<typename Func>
+		void ParallelFor(int count, const Func& func)
+		{
+			Dispatch(count, &Invoke<Func>, &func);
+		}
+
+	private:
+		using JobFunction = void(*)(const void* pContext, int index);
+
+		template<typename Func>
+		static void Invoke(const void* pContext, int index)
+		{
+			(*static_cast<const Func*>(pContext))(index);
+		}
+
+		void Dispatch(int count, JobFunction pJob, const void* pContext);
+		void RunJobs();
+		void WorkerLoop(uint64_t lastGeneration);
+
+		void StartWorkers(int numWorkers);
+		void StopWorkers();
+
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		JobFunction m_pJob{ nullptr };
+		const void* m_pJobContext{ nullptr };
+		int m_JobCount{ 0 };
+		std::atomic<int> m_NextJob{ 0 };
+
+		int m_BusyWorkers{ 0 };
+		uint64_t m_Generation{ 0 };
+		bool m_IsQuitting{ false };
+	};
+}
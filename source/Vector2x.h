@@ -0,0 +1,76 @@
+#pragma once
+#include "Floatx.h"
+#include "Vector2.h"
+
+namespace dae
+{
+	//N Vector2s as a structure of arrays, see Floatx
+	template<int N>
+	struct Vector2x
+	{
+		Floatx<N> x{};
+		Floatx<N> y{};
+
+		static Vector2x Broadcast(const Vector2& v)
+		{
+			return { Floatx<N>::Broadcast(v.x), Floatx<N>::Broadcast(v.y) };
+		}
+
+		Vector2 GetLane(int lane) const
+		{
+			return { x.lanes[lane], y.lanes[lane] };
+		}
+
+		void SetLane(int lane, const Vector2& v)
+		{
+			x.lanes[lane] = v.x;
+			y.lanes[lane] = v.y;
+		}
+
+		static Floatx<N> Dot(const Vector2x& v1, const Vector2x& v2)
+		{
+			return v1.x * v2.x + v1.y * v2.y;
+		}
+
+		#pragma region Vector2x (Member) Operators
+		Vector2x operator+(const Vector2x& v) const
+		{
+			return { x + v.x, y + v.y };
+		}
+
+		Vector2x operator-(const Vector2x& v) const
+		{
+			return { x - v.x, y - v.y };
+		}
+
+		Vector2x operator*(const Floatx<N>& scale) const
+		{
+			return { x * scale, y * scale };
+		}
+
+		Vector2x operator*(float scale) const
+		{
+			return { x * scale, y * scale };
+		}
+		#pragma endregion
+	};
+
+	//Global Operators
+	template<int N>
+	inline Vector2x<N> operator*(const Floatx<N>& scale, const Vector2x<N>& v)
+	{
+		return v * scale;
+	}
+
+	template<int N>
+	inline Vector2x<N> Lerp(const Vector2x<N>& v1, const Vector2x<N>& v2, const Floatx<N>& factor)
+	{
+		return { Lerp(v1.x, v2.x, factor), Lerp(v1.y, v2.y, factor) };
+	}
+
+	template<int N>
+	inline Vector2x<N> Select(uint32_t laneMask, const Vector2x<N>& v1, const Vector2x<N>& v2)
+	{
+		return { Select(laneMask, v1.x, v2.x), Select(laneMask, v1.y, v2.y) };
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "Floatx.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	//N Vector3s as a structure of arrays, see Floatx
+	//The operations do the same arithmetic in the same order as Vector3, lane i matches the scalar result exactly
+	template<int N>
+	struct Vector3x
+	{
+		Floatx<N> x{};
+		Floatx<N> y{};
+		Floatx<N> z{};
+
+		static Vector3x Broadcast(const Vector3& v)
+		{
+			return { Floatx<N>::Broadcast(v.x), Floatx<N>::Broadcast(v.y), Floatx<N>::Broadcast(v.z) };
+		}
+
+		Vector3 GetLane(int lane) const
+		{
+			return { x.lanes[lane], y.lanes[lane], z.lanes[lane] };
+		}
+
+		void SetLane(int lane, const Vector3& v)
+		{
+			x.lanes[lane] = v.x;
+			y.lanes[lane] = v.y;
+			z.lanes[lane] = v.z;
+		}
+
+		Floatx<N> Magnitude() const
+		{
+			return Sqrt(x * x + y * y + z * z);
+		}
+
+		Floatx<N> SqrMagnitude() const
+		{
+			return x * x + y * y + z * z;
+		}
+
+		Floatx<N> Normalize()
+		{
+			const Floatx<N> m{ Magnitude() };
+			x = x / m;
+			y = y / m;
+			z = z / m;
+
+			return m;
+		}
+
+		Vector3x Normalized() const
+		{
+			const Floatx<N> m{ Magnitude() };
+			return { x / m, y / m, z / m };
+		}
+
+		//Scaled with FastRSqrt instead of divided by the magnitude, see FastRSqrtf for the error
+		void FastNormalize()
+		{
+			const Floatx<N> invMagnitude{ FastRSqrt(SqrMagnitude()) };
+			x = x * invMagnitude;
+			y = y * invMagnitude;
+			z = z * invMagnitude;
+		}
+
+		Vector3x FastNormalized() const
+		{
+			const Floatx<N> invMagnitude{ FastRSqrt(SqrMagnitude()) };
+			return { x * invMagnitude, y * invMagnitude, z * invMagnitude };
+		}
+
+		static Floatx<N> Dot(const Vector3x& v1, const Vector3x& v2)
+		{
+			return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+		}
+
+		static Vector3x Cross(const Vector3x& v1, const Vector3x& v2)
+		{
+			return Vector3x{
+				v1.y * v2.z - v1.z * v2.y,
+				v1.z * v2.x - v1.x * v2.z,
+				v1.x * v2.y - v1.y * v2.x
+			};
+		}
+
+		static Vector3x Reflect(const Vector3x& v1, const Vector3x& v2)
+		{
+			return v1 - (2.f * Vector3x::Dot(v1, v2) * v2);
+		}
+
+		#pragma region Vector3x (Member) Operators
+		Vector3x operator+(const Vector3x& v) const
+		{
+			return { x + v.x, y + v.y, z + v.z };
+		}
+
+		Vector3x operator-(const Vector3x& v) const
+		{
+			return { x - v.x, y - v.y, z - v.z };
+		}
+
+		Vector3x operator-() const
+		{
+			return { -x, -y, -z };
+		}
+
+		Vector3x operator*(const Floatx<N>& scale) const
+		{
+			return { x * scale, y * scale, z * scale };
+		}
+
+		Vector3x operator*(float scale) const
+		{
+			return { x * scale, y * scale, z * scale };
+		}
+
+		Vector3x operator/(const Floatx<N>& scale) const
+		{
+			return { x / scale, y / scale, z / scale };
+		}
+		#pragma endregion
+	};
+
+	//Global Operators
+	template<int N>
+	inline Vector3x<N> operator*(const Floatx<N>& scale, const Vector3x<N>& v)
+	{
+		return v * scale;
+	}
+
+	template<int N>
+	inline Vector3x<N> Lerp(const Vector3x<N>& v1, const Vector3x<N>& v2, const Floatx<N>& factor)
+	{
+		return { Lerp(v1.x, v2.x, factor), Lerp(v1.y, v2.y, factor), Lerp(v1.z, v2.z, factor) };
+	}
+
+	template<int N>
+	inline Vector3x<N> Select(uint32_t laneMask, const Vector3x<N>& v1, const Vector3x<N>& v2)
+	{
+		return { Select(laneMask, v1.x, v2.x), Select(laneMask, v1.y, v2.y), Select(laneMask, v1.z, v2.z) };
+	}
+}
@@ -0,0 +1,550 @@
+#include "pch.h"
+#include "VertexKernels.h"
+
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace VertexKernels
+	{
+		TransformSetup CreateTransformSetup(const Matrix& worldViewProjection, const Matrix& world, const Vector3& cameraOrigin, int viewportWidth, int viewportHeight)
+		{
+			TransformSetup setup{};
+			for (int row{}; row < 4; ++row)
+			{
+				for (int column{}; column < 4; ++column)
+				{
+					setup.worldViewProjection[row][column] = worldViewProjection[row][column];
+					setup.world[row][column] = world[row][column];
+				}
+			}
+			setup.cameraOrigin[0] = cameraOrigin.x;
+			setup.cameraOrigin[1] = cameraOrigin.y;
+			setup.cameraOrigin[2] = cameraOrigin.z;
+			setup.viewportWidth = static_cast<float>(viewportWidth);
+			setup.viewportHeight = static_cast<float>(viewportHeight);
+			return setup;
+		}
+
+		uint32_t ComputeOutcode(const Vector4& clipPosition)
+		{
+			const float guardBandW{ GuardBand * clipPosition.w };
+
+			uint32_t outcode{ 0 };
+			if (clipPosition.x < -clipPosition.w) outcode |= ClipLeft;
+			if (clipPosition.x > clipPosition.w) outcode |= ClipRight;
+			if (clipPosition.y < -clipPosition.w) outcode |= ClipBottom;
+			if (clipPosition.y > clipPosition.w) outcode |= ClipTop;
+			if (clipPosition.z < 0) outcode |= ClipNear;
+			if (clipPosition.z > clipPosition.w) outcode |= ClipFar;
+			if (clipPosition.x < -guardBandW) outcode |= ClipGuardLeft;
+			if (clipPosition.x > guardBandW) outcode |= ClipGuardRight;
+			if (clipPosition.y < -guardBandW) outcode |= ClipGuardBottom;
+			if (clipPosition.y > guardBandW) outcode |= ClipGuardTop;
+			return outcode;
+		}
+
+		//Same result as lroundf, halfway cases round away from zero
+		//The difference between a float and its truncation is exact, raster positions inside the guard band always fit in an int
+		static int32_t RoundToFixed(float value)
+		{
+			const int32_t truncated{ static_cast<int32_t>(value) };
+			const float fraction{ value - static_cast<float>(truncated) };
+			return truncated + (fraction >= .5f) - (fraction <= -.5f);
+		}
+
+		//Perspective divide, NDC to raster space and snap to the sub-pixel grid
+		static void ProjectToRaster(const Vector4& clipPosition, float viewportWidth, float viewportHeight, Vertex_Raster& rasterVertex)
+		{
+			rasterVertex.invW = 1.f / clipPosition.w;
+
+			const float rasterX{ (clipPosition.x * rasterVertex.invW + 1) / 2.f * viewportWidth };
+			const float rasterY{ (1 - clipPosition.y * rasterVertex.invW) / 2.f * viewportHeight };
+			rasterVertex.fixedX = RoundToFixed(rasterX * SubPixelSteps);
+			rasterVertex.fixedY = RoundToFixed(rasterY * SubPixelSteps);
+			rasterVertex.z = clipPosition.z * rasterVertex.invW;
+		}
+
+		Vertex_Raster ToRasterVertex(const Vector4& clipPosition, float viewportWidth, float viewportHeight)
+		{
+			Vertex_Raster rasterVertex{};
+			rasterVertex.outcode = ComputeOutcode(clipPosition);
+
+			//Vertices that still need clipping only ever reach setup through the clipper
+			if ((rasterVertex.outcode & ClipPlanesMask) != 0) return rasterVertex;
+
+			ProjectToRaster(clipPosition, viewportWidth, viewportHeight, rasterVertex);
+			return rasterVertex;
+		}
+
+		Vertex_Raster ToClippedRasterVertex(const Vector4& clipPosition, float viewportWidth, float viewportHeight)
+		{
+			//Rounding can leave a vertex a hair outside the plane it was clipped against, it is on that plane as far as setup is concerned
+			Vertex_Raster rasterVertex{};
+			rasterVertex.outcode = ComputeOutcode(clipPosition) & ~ClipPlanesMask;
+
+			ProjectToRaster(clipPosition, viewportWidth, viewportHeight, rasterVertex);
+			return rasterVertex;
+		}
+
+		static Vector3 NormalizedScalar(float x, float y, float z)
+		{
+			const float magnitude{ sqrtf(x * x + y * y + z * z) };
+			return Vector3{ x / magnitude, y / magnitude, z / magnitude };
+		}
+
+		//What a kernel writes besides the clip space position and the raster vertex
+		enum class Attributes
+		{
+			none,			//depth only passes, the attribute streams are never touched
+			worldSpace,		//normal and tangent transformed to world space, view direction from the world space position
+			objectSpace		//normal, tangent and binormal copied as they are, view direction from the object space position
+		};
+
+		template<Attributes Output>
+		static void TransformScalarT(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			const auto& m{ setup.worldViewProjection };
+			const auto& w{ setup.world };
+
+			for (int i{ begin }; i < end; ++i)
+			{
+				const float x{ streams.positionX[i] };
+				const float y{ streams.positionY[i] };
+				const float z{ streams.positionZ[i] };
+
+				Vertex_Out& vertex{ pVertices[i] };
+				vertex.position = Vector4{
+					m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0],
+					m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1],
+					m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2],
+					m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3] };
+				pRasterVertices[i] = ToRasterVertex(vertex.position, setup.viewportWidth, setup.viewportHeight);
+
+				if constexpr (Output == Attributes::none) continue;
+
+				vertex.uv = Vector2{ streams.u[i], streams.v[i] };
+
+				//The camera origin of the setup is in object space as well
+				if constexpr (Output == Attributes::objectSpace)
+				{
+					vertex.normal = Vector3{ streams.normalX[i], streams.normalY[i], streams.normalZ[i] };
+					vertex.tangent = Vector3{ streams.tangentX[i], streams.tangentY[i], streams.tangentZ[i] };
+					vertex.binormal = Vector3{ streams.binormalX[i], streams.binormalY[i], streams.binormalZ[i] };
+					vertex.viewDirection = NormalizedScalar(x - setup.cameraOrigin[0], y - setup.cameraOrigin[1], z - setup.cameraOrigin[2]);
+					continue;
+				}
+
+				const float nx{ streams.normalX[i] };
+				const float ny{ streams.normalY[i] };
+				const float nz{ streams.normalZ[i] };
+				const float tx{ streams.tangentX[i] };
+				const float ty{ streams.tangentY[i] };
+				const float tz{ streams.tangentZ[i] };
+
+				vertex.normal = NormalizedScalar(
+					w[0][0] * nx + w[1][0] * ny + w[2][0] * nz,
+					w[0][1] * nx + w[1][1] * ny + w[2][1] * nz,
+					w[0][2] * nx + w[1][2] * ny + w[2][2] * nz);
+				vertex.tangent = NormalizedScalar(
+					w[0][0] * tx + w[1][0] * ty + w[2][0] * tz,
+					w[0][1] * tx + w[1][1] * ty + w[2][1] * tz,
+					w[0][2] * tx + w[1][2] * ty + w[2][2] * tz);
+				vertex.viewDirection = NormalizedScalar(
+					w[0][0] * x + w[1][0] * y + w[2][0] * z + w[3][0] - setup.cameraOrigin[0],
+					w[0][1] * x + w[1][1] * y + w[2][1] * z + w[3][1] - setup.cameraOrigin[1],
+					w[0][2] * x + w[1][2] * y + w[2][2] * z + w[3][2] - setup.cameraOrigin[2]);
+			}
+		}
+
+		//Lane results of one group of vertices, written back to the vertices one by one
+		template<int Width>
+		struct TransformResult
+		{
+			float position[4][Width];
+			float normal[3][Width];
+			float tangent[3][Width];
+			float viewDirection[3][Width];
+			int32_t fixedX[Width];
+			int32_t fixedY[Width];
+			float z[Width];
+			float invW[Width];
+			uint32_t outcode[Width];
+		};
+
+		template<Attributes Output, int Width>
+		static void StoreTransformResult(const TransformResult<Width>& result, const VertexStreams& streams, int first, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			for (int lane{}; lane < Width; ++lane)
+			{
+				const int i{ first + lane };
+				Vertex_Raster& rasterVertex{ pRasterVertices[i] };
+				rasterVertex.fixedX = result.fixedX[lane];
+				rasterVertex.fixedY = result.fixedY[lane];
+				rasterVertex.z = result.z[lane];
+				rasterVertex.invW = result.invW[lane];
+				rasterVertex.outcode = result.outcode[lane];
+
+				Vertex_Out& vertex{ pVertices[i] };
+				vertex.position = Vector4{ result.position[0][lane], result.position[1][lane], result.position[2][lane], result.position[3][lane] };
+				if constexpr (Output == Attributes::none) continue;
+
+				vertex.uv = Vector2{ streams.u[i], streams.v[i] };
+				if constexpr (Output == Attributes::objectSpace)
+				{
+					vertex.normal = Vector3{ streams.normalX[i], streams.normalY[i], streams.normalZ[i] };
+					vertex.tangent = Vector3{ streams.tangentX[i], streams.tangentY[i], streams.tangentZ[i] };
+					vertex.binormal = Vector3{ streams.binormalX[i], streams.binormalY[i], streams.binormalZ[i] };
+				}
+				else
+				{
+					vertex.normal = Vector3{ result.normal[0][lane], result.normal[1][lane], result.normal[2][lane] };
+					vertex.tangent = Vector3{ result.tangent[0][lane], result.tangent[1][lane], result.tangent[2][lane] };
+				}
+				vertex.viewDirection = Vector3{ result.viewDirection[0][lane], result.viewDirection[1][lane], result.viewDirection[2][lane] };
+			}
+		}
+
+		//Column c of the rotation part times the x, y and z lanes, summed left to right like the scalar version
+		static __m128 MultiplyColumnSSE41(const __m128 (&m)[4][4], int c, __m128 x, __m128 y, __m128 z)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][c], x), _mm_mul_ps(m[1][c], y)), _mm_mul_ps(m[2][c], z));
+		}
+
+		static void NormalizeSSE41(__m128 x, __m128 y, __m128 z, float (&out)[3][4])
+		{
+			const __m128 magnitude{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) };
+			_mm_storeu_ps(out[0], _mm_div_ps(x, magnitude));
+			_mm_storeu_ps(out[1], _mm_div_ps(y, magnitude));
+			_mm_storeu_ps(out[2], _mm_div_ps(z, magnitude));
+		}
+
+		static __m128i RoundToFixedSSE41(__m128 value)
+		{
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 truncated{ _mm_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC) };
+			const __m128 fraction{ _mm_sub_ps(value, truncated) };
+			const __m128 up{ _mm_and_ps(_mm_cmpge_ps(fraction, _mm_set1_ps(.5f)), one) };
+			const __m128 down{ _mm_and_ps(_mm_cmple_ps(fraction, _mm_set1_ps(-.5f)), one) };
+			return _mm_cvttps_epi32(_mm_sub_ps(_mm_add_ps(truncated, up), down));
+		}
+
+		static __m128 OutcodeBitSSE41(__m128 outside, uint32_t bit)
+		{
+			return _mm_and_ps(outside, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(bit))));
+		}
+
+		static void ToRasterVerticesSSE41(const TransformSetup& setup, __m128 x, __m128 y, __m128 z, __m128 w, TransformResult<4>& result)
+		{
+			const __m128 signBit{ _mm_set1_ps(-0.f) };
+			const __m128 negativeW{ _mm_xor_ps(w, signBit) };
+			const __m128 guardBandW{ _mm_mul_ps(_mm_set1_ps(GuardBand), w) };
+			const __m128 negativeGuardBandW{ _mm_xor_ps(guardBandW, signBit) };
+
+			//Outcode bits are built in the float registers, only bitwise operations touch them
+			const __m128 outsideNear{ _mm_cmplt_ps(z, _mm_setzero_ps()) };
+			const __m128 guardLeft{ _mm_cmplt_ps(x, negativeGuardBandW) };
+			const __m128 guardRight{ _mm_cmpgt_ps(x, guardBandW) };
+			const __m128 guardBottom{ _mm_cmplt_ps(y, negativeGuardBandW) };
+			const __m128 guardTop{ _mm_cmpgt_ps(y, guardBandW) };
+
+			__m128 outcode{ _mm_or_ps(OutcodeBitSSE41(_mm_cmplt_ps(x, negativeW), ClipLeft), OutcodeBitSSE41(_mm_cmpgt_ps(x, w), ClipRight)) };
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(_mm_cmplt_ps(y, negativeW), ClipBottom));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(_mm_cmpgt_ps(y, w), ClipTop));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(outsideNear, ClipNear));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(_mm_cmpgt_ps(z, w), ClipFar));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(guardLeft, ClipGuardLeft));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(guardRight, ClipGuardRight));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(guardBottom, ClipGuardBottom));
+			outcode = _mm_or_ps(outcode, OutcodeBitSSE41(guardTop, ClipGuardTop));
+			_mm_storeu_ps(reinterpret_cast<float*>(result.outcode), outcode);
+
+			//Lanes that need clipping keep zeroed raster data, like the scalar version
+			const __m128 clipped{ _mm_or_ps(_mm_or_ps(_mm_or_ps(outsideNear, guardLeft), _mm_or_ps(guardRight, guardBottom)), guardTop) };
+
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 two{ _mm_set1_ps(2.f) };
+			const __m128 subPixelSteps{ _mm_set1_ps(static_cast<float>(SubPixelSteps)) };
+			const __m128 invW{ _mm_div_ps(one, w) };
+			const __m128 rasterX{ _mm_mul_ps(_mm_div_ps(_mm_add_ps(_mm_mul_ps(x, invW), one), two), _mm_set1_ps(setup.viewportWidth)) };
+			const __m128 rasterY{ _mm_mul_ps(_mm_div_ps(_mm_sub_ps(one, _mm_mul_ps(y, invW)), two), _mm_set1_ps(setup.viewportHeight)) };
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result.fixedX), _mm_andnot_si128(_mm_castps_si128(clipped), RoundToFixedSSE41(_mm_mul_ps(rasterX, subPixelSteps))));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result.fixedY), _mm_andnot_si128(_mm_castps_si128(clipped), RoundToFixedSSE41(_mm_mul_ps(rasterY, subPixelSteps))));
+			_mm_storeu_ps(result.z, _mm_andnot_ps(clipped, _mm_mul_ps(z, invW)));
+			_mm_storeu_ps(result.invW, _mm_andnot_ps(clipped, invW));
+		}
+
+		template<Attributes Output>
+		static void TransformSSE41T(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			__m128 m[4][4];
+			__m128 w[4][4];
+			for (int row{}; row < 4; ++row)
+			{
+				for (int column{}; column < 4; ++column)
+				{
+					m[row][column] = _mm_set1_ps(setup.worldViewProjection[row][column]);
+					w[row][column] = _mm_set1_ps(setup.world[row][column]);
+				}
+			}
+			const __m128 originX{ _mm_set1_ps(setup.cameraOrigin[0]) };
+			const __m128 originY{ _mm_set1_ps(setup.cameraOrigin[1]) };
+			const __m128 originZ{ _mm_set1_ps(setup.cameraOrigin[2]) };
+
+			TransformResult<4> result{};
+
+			int i{ begin };
+			for (; i + 4 <= end; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(&streams.positionX[i]) };
+				const __m128 y{ _mm_loadu_ps(&streams.positionY[i]) };
+				const __m128 z{ _mm_loadu_ps(&streams.positionZ[i]) };
+
+				__m128 clipPosition[4];
+				for (int c{}; c < 4; ++c)
+				{
+					clipPosition[c] = _mm_add_ps(MultiplyColumnSSE41(m, c, x, y, z), m[3][c]);
+					_mm_storeu_ps(result.position[c], clipPosition[c]);
+				}
+				ToRasterVerticesSSE41(setup, clipPosition[0], clipPosition[1], clipPosition[2], clipPosition[3], result);
+
+				if constexpr (Output == Attributes::none)
+				{
+					StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+					continue;
+				}
+
+				if constexpr (Output == Attributes::objectSpace)
+				{
+					NormalizeSSE41(_mm_sub_ps(x, originX), _mm_sub_ps(y, originY), _mm_sub_ps(z, originZ), result.viewDirection);
+					StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+					continue;
+				}
+
+				const __m128 nx{ _mm_loadu_ps(&streams.normalX[i]) };
+				const __m128 ny{ _mm_loadu_ps(&streams.normalY[i]) };
+				const __m128 nz{ _mm_loadu_ps(&streams.normalZ[i]) };
+				NormalizeSSE41(MultiplyColumnSSE41(w, 0, nx, ny, nz), MultiplyColumnSSE41(w, 1, nx, ny, nz), MultiplyColumnSSE41(w, 2, nx, ny, nz), result.normal);
+
+				const __m128 tx{ _mm_loadu_ps(&streams.tangentX[i]) };
+				const __m128 ty{ _mm_loadu_ps(&streams.tangentY[i]) };
+				const __m128 tz{ _mm_loadu_ps(&streams.tangentZ[i]) };
+				NormalizeSSE41(MultiplyColumnSSE41(w, 0, tx, ty, tz), MultiplyColumnSSE41(w, 1, tx, ty, tz), MultiplyColumnSSE41(w, 2, tx, ty, tz), result.tangent);
+
+				NormalizeSSE41(
+					_mm_sub_ps(_mm_add_ps(MultiplyColumnSSE41(w, 0, x, y, z), w[3][0]), originX),
+					_mm_sub_ps(_mm_add_ps(MultiplyColumnSSE41(w, 1, x, y, z), w[3][1]), originY),
+					_mm_sub_ps(_mm_add_ps(MultiplyColumnSSE41(w, 2, x, y, z), w[3][2]), originZ),
+					result.viewDirection);
+
+				StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+			}
+
+			//Remaining vertices
+			TransformScalarT<Output>(setup, streams, i, end, pVertices, pRasterVertices);
+		}
+
+		static __m256 MultiplyColumnAVX(const __m256 (&m)[4][4], int c, __m256 x, __m256 y, __m256 z)
+		{
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][c], x), _mm256_mul_ps(m[1][c], y)), _mm256_mul_ps(m[2][c], z));
+		}
+
+		static void NormalizeAVX(__m256 x, __m256 y, __m256 z, float (&out)[3][8])
+		{
+			const __m256 magnitude{ _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z))) };
+			_mm256_storeu_ps(out[0], _mm256_div_ps(x, magnitude));
+			_mm256_storeu_ps(out[1], _mm256_div_ps(y, magnitude));
+			_mm256_storeu_ps(out[2], _mm256_div_ps(z, magnitude));
+		}
+
+		//AVX has no 256 bit integer arithmetic, so rounding stays in floats until the final conversion
+		static __m256i RoundToFixedAVX(__m256 value)
+		{
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 truncated{ _mm256_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC) };
+			const __m256 fraction{ _mm256_sub_ps(value, truncated) };
+			const __m256 up{ _mm256_and_ps(_mm256_cmp_ps(fraction, _mm256_set1_ps(.5f), _CMP_GE_OQ), one) };
+			const __m256 down{ _mm256_and_ps(_mm256_cmp_ps(fraction, _mm256_set1_ps(-.5f), _CMP_LE_OQ), one) };
+			return _mm256_cvttps_epi32(_mm256_sub_ps(_mm256_add_ps(truncated, up), down));
+		}
+
+		static __m256 OutcodeBitAVX(__m256 outside, uint32_t bit)
+		{
+			return _mm256_and_ps(outside, _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(bit))));
+		}
+
+		static void ToRasterVerticesAVX(const TransformSetup& setup, __m256 x, __m256 y, __m256 z, __m256 w, TransformResult<8>& result)
+		{
+			const __m256 signBit{ _mm256_set1_ps(-0.f) };
+			const __m256 negativeW{ _mm256_xor_ps(w, signBit) };
+			const __m256 guardBandW{ _mm256_mul_ps(_mm256_set1_ps(GuardBand), w) };
+			const __m256 negativeGuardBandW{ _mm256_xor_ps(guardBandW, signBit) };
+
+			//Outcode bits are built in the float registers, only bitwise operations touch them
+			const __m256 outsideNear{ _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_LT_OQ) };
+			const __m256 guardLeft{ _mm256_cmp_ps(x, negativeGuardBandW, _CMP_LT_OQ) };
+			const __m256 guardRight{ _mm256_cmp_ps(x, guardBandW, _CMP_GT_OQ) };
+			const __m256 guardBottom{ _mm256_cmp_ps(y, negativeGuardBandW, _CMP_LT_OQ) };
+			const __m256 guardTop{ _mm256_cmp_ps(y, guardBandW, _CMP_GT_OQ) };
+
+			__m256 outcode{ _mm256_or_ps(OutcodeBitAVX(_mm256_cmp_ps(x, negativeW, _CMP_LT_OQ), ClipLeft), OutcodeBitAVX(_mm256_cmp_ps(x, w, _CMP_GT_OQ), ClipRight)) };
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(_mm256_cmp_ps(y, negativeW, _CMP_LT_OQ), ClipBottom));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(_mm256_cmp_ps(y, w, _CMP_GT_OQ), ClipTop));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(outsideNear, ClipNear));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(_mm256_cmp_ps(z, w, _CMP_GT_OQ), ClipFar));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(guardLeft, ClipGuardLeft));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(guardRight, ClipGuardRight));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(guardBottom, ClipGuardBottom));
+			outcode = _mm256_or_ps(outcode, OutcodeBitAVX(guardTop, ClipGuardTop));
+			_mm256_storeu_ps(reinterpret_cast<float*>(result.outcode), outcode);
+
+			//Lanes that need clipping keep zeroed raster data, like the scalar version
+			const __m256 clipped{ _mm256_or_ps(_mm256_or_ps(_mm256_or_ps(outsideNear, guardLeft), _mm256_or_ps(guardRight, guardBottom)), guardTop) };
+
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 two{ _mm256_set1_ps(2.f) };
+			const __m256 subPixelSteps{ _mm256_set1_ps(static_cast<float>(SubPixelSteps)) };
+			const __m256 invW{ _mm256_div_ps(one, w) };
+			const __m256 rasterX{ _mm256_mul_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(x, invW), one), two), _mm256_set1_ps(setup.viewportWidth)) };
+			const __m256 rasterY{ _mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(one, _mm256_mul_ps(y, invW)), two), _mm256_set1_ps(setup.viewportHeight)) };
+
+			_mm256_storeu_ps(reinterpret_cast<float*>(result.fixedX), _mm256_andnot_ps(clipped, _mm256_castsi256_ps(RoundToFixedAVX(_mm256_mul_ps(rasterX, subPixelSteps)))));
+			_mm256_storeu_ps(reinterpret_cast<float*>(result.fixedY), _mm256_andnot_ps(clipped, _mm256_castsi256_ps(RoundToFixedAVX(_mm256_mul_ps(rasterY, subPixelSteps)))));
+			_mm256_storeu_ps(result.z, _mm256_andnot_ps(clipped, _mm256_mul_ps(z, invW)));
+			_mm256_storeu_ps(result.invW, _mm256_andnot_ps(clipped, invW));
+		}
+
+		//No fused multiply-add, so the results match the scalar kernel bit for bit
+		template<Attributes Output>
+		static void TransformAVXT(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			__m256 m[4][4];
+			__m256 w[4][4];
+			for (int row{}; row < 4; ++row)
+			{
+				for (int column{}; column < 4; ++column)
+				{
+					m[row][column] = _mm256_set1_ps(setup.worldViewProjection[row][column]);
+					w[row][column] = _mm256_set1_ps(setup.world[row][column]);
+				}
+			}
+			const __m256 originX{ _mm256_set1_ps(setup.cameraOrigin[0]) };
+			const __m256 originY{ _mm256_set1_ps(setup.cameraOrigin[1]) };
+			const __m256 originZ{ _mm256_set1_ps(setup.cameraOrigin[2]) };
+
+			TransformResult<8> result{};
+
+			int i{ begin };
+			for (; i + 8 <= end; i += 8)
+			{
+				const __m256 x{ _mm256_loadu_ps(&streams.positionX[i]) };
+				const __m256 y{ _mm256_loadu_ps(&streams.positionY[i]) };
+				const __m256 z{ _mm256_loadu_ps(&streams.positionZ[i]) };
+
+				__m256 clipPosition[4];
+				for (int c{}; c < 4; ++c)
+				{
+					clipPosition[c] = _mm256_add_ps(MultiplyColumnAVX(m, c, x, y, z), m[3][c]);
+					_mm256_storeu_ps(result.position[c], clipPosition[c]);
+				}
+				ToRasterVerticesAVX(setup, clipPosition[0], clipPosition[1], clipPosition[2], clipPosition[3], result);
+
+				if constexpr (Output == Attributes::none)
+				{
+					StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+					continue;
+				}
+
+				if constexpr (Output == Attributes::objectSpace)
+				{
+					NormalizeAVX(_mm256_sub_ps(x, originX), _mm256_sub_ps(y, originY), _mm256_sub_ps(z, originZ), result.viewDirection);
+					StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+					continue;
+				}
+
+				const __m256 nx{ _mm256_loadu_ps(&streams.normalX[i]) };
+				const __m256 ny{ _mm256_loadu_ps(&streams.normalY[i]) };
+				const __m256 nz{ _mm256_loadu_ps(&streams.normalZ[i]) };
+				NormalizeAVX(MultiplyColumnAVX(w, 0, nx, ny, nz), MultiplyColumnAVX(w, 1, nx, ny, nz), MultiplyColumnAVX(w, 2, nx, ny, nz), result.normal);
+
+				const __m256 tx{ _mm256_loadu_ps(&streams.tangentX[i]) };
+				const __m256 ty{ _mm256_loadu_ps(&streams.tangentY[i]) };
+				const __m256 tz{ _mm256_loadu_ps(&streams.tangentZ[i]) };
+				NormalizeAVX(MultiplyColumnAVX(w, 0, tx, ty, tz), MultiplyColumnAVX(w, 1, tx, ty, tz), MultiplyColumnAVX(w, 2, tx, ty, tz), result.tangent);
+
+				NormalizeAVX(
+					_mm256_sub_ps(_mm256_add_ps(MultiplyColumnAVX(w, 0, x, y, z), w[3][0]), originX),
+					_mm256_sub_ps(_mm256_add_ps(MultiplyColumnAVX(w, 1, x, y, z), w[3][1]), originY),
+					_mm256_sub_ps(_mm256_add_ps(MultiplyColumnAVX(w, 2, x, y, z), w[3][2]), originZ),
+					result.viewDirection);
+
+				StoreTransformResult<Output>(result, streams, i, pVertices, pRasterVertices);
+			}
+
+			//Remaining vertices
+			TransformScalarT<Output>(setup, streams, i, end, pVertices, pRasterVertices);
+		}
+
+		void TransformScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformScalarT<Attributes::worldSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformSSE41T<Attributes::worldSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformAVXT<Attributes::worldSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformPositionsScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformScalarT<Attributes::none>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformObjectSpaceScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformScalarT<Attributes::objectSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformPositionsSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformSSE41T<Attributes::none>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformObjectSpaceSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformSSE41T<Attributes::objectSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformPositionsAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformAVXT<Attributes::none>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		void TransformObjectSpaceAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices)
+		{
+			TransformAVXT<Attributes::objectSpace>(setup, streams, begin, end, pVertices, pRasterVertices);
+		}
+
+		const KernelSet& GetScalarKernels()
+		{
+			static const KernelSet scalarKernels{ "scalar", &TransformScalar, &TransformPositionsScalar, &TransformObjectSpaceScalar };
+			return scalarKernels;
+		}
+
+		const KernelSet& SelectKernels()
+		{
+			static const KernelSet sse41Kernels{ "SSE4.1", &TransformSSE41, &TransformPositionsSSE41, &TransformObjectSpaceSSE41 };
+			static const KernelSet avxKernels{ "AVX", &TransformAVX, &TransformPositionsAVX, &TransformObjectSpaceAVX };
+
+			if (SDL_HasAVX()) return avxKernels;
+			if (SDL_HasSSE41()) return sse41Kernels;
+			return GetScalarKernels();
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace VertexKernels
+	{
+		//Outcode bits, one per clip space plane
+		constexpr uint32_t ClipLeft{ 1u << 0 };
+		constexpr uint32_t ClipRight{ 1u << 1 };
+		constexpr uint32_t ClipBottom{ 1u << 2 };
+		constexpr uint32_t ClipTop{ 1u << 3 };
+		constexpr uint32_t ClipNear{ 1u << 4 };
+		constexpr uint32_t ClipFar{ 1u << 5 };
+		constexpr uint32_t ClipGuardLeft{ 1u << 6 };
+		constexpr uint32_t ClipGuardRight{ 1u << 7 };
+		constexpr uint32_t ClipGuardBottom{ 1u << 8 };
+		constexpr uint32_t ClipGuardTop{ 1u << 9 };
+		//Planes that really get clipped against, the far plane is handled by the per pixel depth range test
+		constexpr uint32_t ClipPlanesMask{ ClipNear | ClipGuardLeft | ClipGuardRight | ClipGuardBottom | ClipGuardTop };
+		//Guard band size in NDC, 4 screens wide and high
+		constexpr float GuardBand{ 4.f };
+
+		//Raster positions are snapped to 28.4 fixed point
+		constexpr int32_t SubPixelBits{ 4 };
+		constexpr int32_t SubPixelSteps{ 1 << SubPixelBits };
+
+		struct TransformSetup
+		{
+			float worldViewProjection[4][4];	//row-major, rows are the x, y, z axes and the translation
+			float world[4][4];
+			float cameraOrigin[3];
+			float viewportWidth;
+			float viewportHeight;
+		};
+		TransformSetup CreateTransformSetup(const Matrix& worldViewProjection, const Matrix& world, const Vector3& cameraOrigin, int viewportWidth, int viewportHeight);
+
+		uint32_t ComputeOutcode(const Vector4& clipPosition);
+		//Outcode, and for vertices that don't need clipping the snapped raster position, depth and 1 / w
+		Vertex_Raster ToRasterVertex(const Vector4& clipPosition, float viewportWidth, float viewportHeight);
+		//Same for a vertex the clipper made, which always gets its raster position and never has the bits of the clip planes set
+		Vertex_Raster ToClippedRasterVertex(const Vector4& clipPosition, float viewportWidth, float viewportHeight);
+
+		//Transforms the vertices [begin, end) of the streams to clip space and world space and computes their raster vertices
+		//Every kernel does the exact same operations in the same order as Matrix::TransformPoint / TransformVector, Vector3::Normalized and ToRasterVertex
+		using TransformKernel = void(*)(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+
+		void TransformScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+
+		//Only read the position streams and only write the clip space position and the raster vertex, for depth only passes
+		void TransformPositionsScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformPositionsSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformPositionsAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+
+		//For lighting in object space, the setup's camera origin has to be in object space too
+		//Copies the normal, tangent and binormal streams as they are, only the view direction is computed per vertex
+		void TransformObjectSpaceScalar(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformObjectSpaceSSE41(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+		void TransformObjectSpaceAVX(const TransformSetup& setup, const VertexStreams& streams, int begin, int end, Vertex_Out* pVertices, Vertex_Raster* pRasterVertices);
+
+		//The kernels of one instruction set
+		struct KernelSet
+		{
+			const char* name;
+			TransformKernel pTransform;
+			TransformKernel pTransformPositions;
+			TransformKernel pTransformObjectSpace;
+		};
+
+		const KernelSet& GetScalarKernels();
+		//Picks the widest kernels the CPU supports
+		const KernelSet& SelectKernels();
+	}
+}
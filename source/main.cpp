@@ -103,6 +103,34 @@ int main(int argc, char* args[])
 				{
 					pTimer->StartBenchmark(10);
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_V)
+				{
+					pRenderer->ToggleVisibilityBuffer();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_Z)
+				{
+					pRenderer->ToggleDepthPrepass();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_P)
+				{
+					pRenderer->ToggleFastSpecular();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_O)
+				{
+					pRenderer->ToggleLightingSpace();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_N)
+				{
+					pRenderer->ToggleFastNormalize();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_B)
+				{
+					pRenderer->RunBenchmarks();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					pRenderer->PrintRasterStats();
+				}
 				break;
 			default: ;
 			}